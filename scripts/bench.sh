@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# Time the analysis stages on synthetic MxAODs
+dir=${1:-/tmp/mxaodgen}
+mkdir -p $dir
+./bin/mxaodgen -d $dir -n ${2:-100000} && \
+./bin/bench $dir/*.MxAOD.root --fits 20
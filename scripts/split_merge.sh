@@ -0,0 +1,21 @@
+#!/bin/bash
+
+# Fill pesfit histograms in entry ranges of 2^20 events, as separate
+# jobs would on different nodes, then merge the partials and fit.
+# Gives the same results as one pesfit run on all files.
+# usage: split_merge.sh out.pdf njobs_per_file mxaod.root...
+out=$1
+n=$2
+shift 2
+tmp=$(mktemp -d)
+chunk=$((1<<20))
+for f in "$@"; do
+  for ((i=0; i<n; ++i)); do
+    last=$(( i+1==n ? -1 : (i+1)*chunk ))
+    ./bin/pesfit $f --entries $((i*chunk)):$last \
+      --partial $tmp/$(basename $f .root)_$i.partial.root &
+  done
+done
+wait
+./bin/pesfit $tmp/*.partial.root -o $out -f cb
+rm -r $tmp
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+# Numbers for the run.sh settings and more, from a single read of the data
+./bin/sweep data/h008/P* -o sweep.root \
+--nbins 50 100 200 --xrange 105:140 110:135 \
+--ws-setRange none 'mean_offset_bin0:-1.5:1.' --fix-alpha 0 1
@@ -197,3 +197,8 @@ Double_t intervalx2(const TGraph* gr, Double_t frac, Double_t x1, Double_t total
 
   return x2;
 }
+
+Double_t fwhm(const TGraph* gr) {
+  const Double_t half_max = max(gr).second/2;
+  return rfindx(gr,half_max) - lfindx(gr,half_max);
+}
@@ -13,6 +13,9 @@ std::pair<Int_t,Double_t> max(const TGraph* gr) noexcept;
 Double_t lfindx(const TGraph* gr, Double_t y) noexcept;
 Double_t rfindx(const TGraph* gr, Double_t y) noexcept;
 
+// Full width at half maximum
+Double_t fwhm(const TGraph* gr);
+
 Double_t integrate(const TGraph* gr, Int_t ixi=0, Int_t ixf=-1) noexcept;
 Double_t ltailx(const TGraph* gr, Double_t frac, Double_t totalint=0.) noexcept;
 Double_t rtailx(const TGraph* gr, Double_t frac, Double_t totalint=0.) noexcept;
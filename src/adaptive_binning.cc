@@ -0,0 +1,25 @@
+#include "adaptive_binning.hh"
+
+#include <TH1.h>
+
+template<typename T> inline T sq(T x) noexcept { return x*x; }
+
+std::vector<double> adaptive_edges(const TH1* fine, double rel_err) {
+  const TAxis *axis = fine->GetXaxis();
+  const int n = fine->GetNbinsX();
+  const double max_rel2 = sq(rel_err);
+
+  std::vector<double> edges { axis->GetBinLowEdge(1) };
+  double sumw = 0., sumw2 = 0.;
+  for (int i=1; i<=n; ++i) {
+    sumw  += fine->GetBinContent(i);
+    sumw2 += sq(fine->GetBinError(i));
+    if (sumw > 0. && sumw2 <= max_rel2*sq(sumw)) {
+      edges.push_back(axis->GetBinUpEdge(i));
+      sumw = sumw2 = 0.;
+    }
+  }
+  if (edges.size()==1) edges.push_back(axis->GetBinUpEdge(n));
+  else edges.back() = axis->GetBinUpEdge(n);
+  return edges;
+}
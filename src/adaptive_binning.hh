@@ -0,0 +1,16 @@
+#ifndef adaptive_binning_hh
+#define adaptive_binning_hh
+
+#include <vector>
+
+class TH1;
+
+// Variable width bin edges derived from a finely binned distribution.
+// Adjacent fine bins are merged until the merged bin's relative
+// statistical uncertainty, sqrt(sum w^2)/sum w, is at most rel_err,
+// so bins are as fine as the input at the peak and coarse in the tails.
+// A remainder at the upper edge that doesn't reach rel_err
+// is merged into the last bin.
+std::vector<double> adaptive_edges(const TH1* fine, double rel_err);
+
+#endif
@@ -0,0 +1,342 @@
+// Time the stages of the analysis on a set of input files,
+// e.g. written by mxaodgen, and report events/s and fits/s
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include <boost/program_options.hpp>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TGraph.h>
+
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooFitResult.h>
+#include <RooMsgService.h>
+
+#include "catstr.hh"
+#include "TGraph_fcns.hh"
+#include "root_safe_get.hh"
+#include "workspace.hh"
+#include "fit_socket.hh"
+#include "window_mean.hh"
+#include "events.hh"
+#include "inputs.hh"
+#include "adaptive_binning.hh"
+#include "bg_template.hh"
+#include "smearing.hh"
+
+using namespace std;
+namespace po = boost::program_options;
+
+#define test(var) \
+  std::cout <<"\033[36m"<< #var <<"\033[0m"<< " = " << var << std::endl;
+
+// Wall time of f() in seconds
+template <typename F>
+double seconds(F&& f) {
+  const auto start = chrono::steady_clock::now();
+  f();
+  return chrono::duration<double>(chrono::steady_clock::now()-start).count();
+}
+
+void report(const char* what, double n, const char* unit, double sec) {
+  cout << left << setw(24) << what << right
+       << setw(14) << n/sec << ' ' << unit << "/s  ("
+       << n << " in " << sec << " s)" << endl;
+}
+
+// keeps results of timed calls from being optimized away
+volatile double sink;
+
+// Parameter differences of res from ref, also in units of ref's errors
+void print_shifts(const char* what, const RooFitResult& ref,
+                  const RooFitResult& res) {
+  cout << endl << what << ':' << endl;
+  for (auto *arg : ref.floatParsFinal()) {
+    const auto *a = static_cast<const RooRealVar*>(arg);
+    const auto *b = static_cast<const RooRealVar*>(
+      res.floatParsFinal().find(a->GetName()));
+    if (!b) continue;
+    cout << "  " << left << setw(24) << a->GetName() << right
+         << setw(14) << b->getVal()-a->getVal() << " ("
+         << (b->getVal()-a->getVal())/a->getError() << " sigma)" << endl;
+  }
+  cout << endl;
+}
+
+int main(int argc, char** argv)
+{
+  vector<string> ifname;
+  string wfname, syst_re, server;
+  int nbins;
+  unsigned nfits, nreps, ncalls;
+  double precision;
+
+  // options ---------------------------------------------------
+  try {
+    po::options_description desc("Options");
+    desc.add_options()
+      ("input,i", po::value(&ifname)->multitoken()->required(),
+       "*input root file names")
+      ("workspace,w", po::value(&wfname)->default_value("data/ws.root"),
+       "ROOT file with RooWorkspace for CB fits")
+      ("syst,s",
+       po::value(&syst_re)->default_value("EG_(SCALE|RESOLUTION)_ALL"),
+       "regex of systematics with m_yy variations, \".*\" for all")
+      ("nbins,n", po::value(&nbins)->default_value(100),
+       "histograms\' number of bins")
+      ("precision,p", po::value(&precision)->default_value(0.02),
+       "adaptive binning relative precision")
+      ("fits,f", po::value(&nfits)->default_value(10),
+       "number of timed fits")
+      ("reps,r", po::value(&nreps)->default_value(10),
+       "number of histogram refills")
+      ("calls", po::value(&ncalls)->default_value(100000),
+       "number of timed window_mean and TGraph_fcns calls")
+      ("server", po::value(&server)->implicit_value(fit_server_socket()),
+       "also fit with the fit server (fitd) on this socket and check\n"
+       "that it gives the same datafit yields as a local fit")
+    ;
+
+    po::positional_options_description pos;
+    pos.add("input",-1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv)
+      .options(desc).positional(pos).run(), vm);
+    if (argc == 1) {
+      cout << desc << endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch (std::exception& e) {
+    cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
+    return 1;
+  }
+  // end options ---------------------------------------------------
+
+  // Read events ****************************************************
+  unique_ptr<event_store> events;
+  Long64_t nread = 0;
+  double sec = 0.;
+  for (const string& f : ifname) {
+    TFile *file = new TFile(f.c_str(),"read");
+    if (file->IsZombie()) return 1;
+    TTree *tree = get<TTree>(file,"CollectionTree");
+
+    const double xsecscale = cutflow_scale(file,f);
+
+    if (!events) events.reset(new event_store(find_variations(tree,syst_re)));
+    sec += seconds([&]{ events->read(tree,xsecscale); });
+    nread += tree->GetEntries();
+
+    delete file;
+  }
+  const auto& vars = events->variations();
+  cout << nread << " events read, " << events->size() << " selected, "
+       << vars.size() << " variations" << endl << endl;
+
+  report("read tree",nread,"events",sec);
+
+  // Fill histograms ************************************************
+  sec = seconds([&]{
+    for (unsigned r=0; r<nreps; ++r)
+      for (size_t i=0; i<vars.size(); ++i)
+        delete events->hist(i,nbins,105,140);
+  });
+  report("fill histograms",double(nreps)*vars.size()*events->size(),
+         "events",sec);
+
+  const auto groups = smearing_engine::groups(*events);
+  if (!groups.empty()) {
+    const smearing_engine smearing(*events,groups.front());
+    const vector<double> magnitudes { -2, -1.5, -1, -0.5, 0.5, 1, 1.5, 2 };
+    sec = seconds([&]{
+      for (unsigned r=0; r<nreps; ++r)
+        for (TH1 *h : smearing.hists(magnitudes,nbins,105,140)) delete h;
+    });
+    report(cat("fill ",magnitudes.size()," ",groups.front(),
+               " magnitudes").c_str(),
+           double(nreps)*magnitudes.size()*events->size(),"events",sec);
+  }
+
+  unique_ptr<TH1> h(events->hist(0,nbins,105,140));
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<ncalls; ++i)
+      sink = window_mean(h.get(),120,130);
+  });
+  report("window_mean",ncalls,"calls",sec);
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<nreps; ++i)
+      exp2_template(-3.4472+1e-3*i, 0.46032, *h->GetXaxis(), 24740.);
+  });
+  report("exp2 background template",nreps,"templates",sec);
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<ncalls; ++i)
+      exp2_template(-3.4472, 0.46032, *h->GetXaxis(), 24740.);
+  });
+  report("cached exp2 background template",ncalls,"calls",sec);
+
+  // Load workspace ************************************************
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+  workspace{wfname}; // make sure the cache exists
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<nfits; ++i) workspace{wfname,false,false};
+  });
+  report("load workspace file",nfits,"loads",sec);
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<nfits; ++i) workspace{wfname};
+  });
+  report("load workspace cache",nfits,"loads",sec);
+
+  // Fit ************************************************************
+  workspace ws(wfname);
+
+  const auto snap = ws.save();
+  sec = seconds([&]{
+    for (unsigned i=0; i<ncalls; ++i) ws.restore(snap);
+  });
+  report(cat("restore ",snap.size()," vars").c_str(),ncalls,"calls",sec);
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<nfits; ++i) ws.clone();
+  });
+  report("clone workspace",nfits,"clones",sec);
+
+  fit_options opt;
+  opt.verbose = false;
+  opt.ncpu = 1;
+
+  // Every fit starts from the workspace as loaded, not from the
+  // previous minimum. The restore is timed too, it costs next to nothing.
+  opt.curve = false;
+  sec = seconds([&]{
+    for (unsigned i=0; i<nfits; ++i) {
+      ws.restore(snap);
+      ws.fit(h.get(),opt);
+    }
+  });
+  report("fit",nfits,"fits",sec);
+
+  opt.curve = true;
+  TGraph *curve = nullptr;
+  sec = seconds([&]{
+    for (unsigned i=0; i<nfits; ++i) {
+      ws.restore(snap);
+      curve = ws.fit(h.get(),opt).second;
+    }
+  });
+  report("fit with curve",nfits,"fits",sec);
+
+  // Unbinned fit ***************************************************
+  // nominal events against the nominal histogram,
+  // every fit from the workspace as loaded
+  opt.curve = false;
+  FitResult binned, unbinned;
+  ws.restore(snap);
+  sec = seconds([&]{ binned = ws.fit(h.get(),opt).first; });
+  report("binned fit",1,"fits",sec);
+  ws.restore(snap);
+  sec = seconds([&]{
+    unbinned = ws.fit(events->masses(0),events->weights(),opt).first;
+  });
+  report("unbinned fit",1,"fits",sec);
+  for (unsigned ncpu : {2u,4u}) {
+    opt.ncpu = ncpu;
+    ws.restore(snap);
+    sec = seconds([&]{ ws.fit(events->masses(0),events->weights(),opt); });
+    report(cat("unbinned fit, ",ncpu," cpu").c_str(),1,"fits",sec);
+  }
+  opt.ncpu = 1;
+
+  print_shifts("unbinned - binned",*binned,*unbinned);
+
+  // Adaptive binning ***********************************************
+  // from a 4 times finer nominal histogram
+  {
+    unique_ptr<TH1> fine(events->hist(0,4*nbins,105,140));
+    const auto edges = adaptive_edges(fine.get(),precision);
+    unique_ptr<TH1> ha(events->hist(0,edges));
+    FitResult adaptive;
+    ws.restore(snap);
+    sec = seconds([&]{ adaptive = ws.fit(ha.get(),opt).first; });
+    report(cat("adaptive fit, ",edges.size()-1," bins").c_str(),1,"fits",sec);
+    print_shifts("adaptive - uniform",*binned,*adaptive);
+  }
+
+  // Fit server *****************************************************
+  // The server must be transparent: the datafit of the uniform nominal
+  // histogram gives the same signal yield through fitd as locally
+  if (!server.empty()) {
+    try {
+      ::close(connect_socket(server));
+    } catch (const fit_server_unavailable& e) {
+      cerr << "\033[31m" << e.what() << "\033[0m" << endl;
+      return 1;
+    }
+    workspace bgws(wfname,true);
+    const auto bgsnap = bgws.save();
+    FitResult local, remote;
+    sec = seconds([&]{ local = bgws.fit(h.get(),opt).first; });
+    report("datafit",1,"fits",sec);
+    bgws.restore(bgsnap);
+    setenv("PESFIT_FIT_SERVER",server.c_str(),1);
+    sec = seconds([&]{ remote = bgws.fit(h.get(),opt).first; });
+    unsetenv("PESFIT_FIT_SERVER");
+    report("fitd datafit",1,"fits",sec);
+    print_shifts("fitd - local",*local,*remote);
+
+    const auto *a = static_cast<const RooRealVar*>(
+      local->floatParsFinal().find("NSig_bin0"));
+    const auto *b = static_cast<const RooRealVar*>(
+      remote->floatParsFinal().find("NSig_bin0"));
+    if (!a || !b || std::abs(b->getVal()-a->getVal()) > 1e-3*a->getError()) {
+      cerr << "\033[31mNSig_bin0 differs between fitd and local fits\033[0m"
+           << endl;
+      return 1;
+    }
+  }
+
+  // Curve functions ************************************************
+  const Double_t half_max = max(curve).second/2;
+  sec = seconds([&]{
+    for (unsigned i=0; i<ncalls; ++i) sink = max(curve).second;
+  });
+  report("max",ncalls,"calls",sec);
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<ncalls; ++i)
+      sink = rfindx(curve,half_max) - lfindx(curve,half_max);
+  });
+  report("FWHM",ncalls,"calls",sec);
+
+  sec = seconds([&]{
+    for (unsigned i=0; i<ncalls; ++i) sink = integrate(curve);
+  });
+  report("integrate",ncalls,"calls",sec);
+
+  const Double_t total = integrate(curve);
+  sec = seconds([&]{
+    for (unsigned i=0; i<ncalls; ++i)
+      sink = intervalx2(curve,0.68,firstx(curve),total);
+  });
+  report("intervalx2",ncalls,"calls",sec);
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include "bg_template.hh"
+
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <stdexcept>
+
+#include <TH1.h>
+
+#include "catstr.hh"
+
+using namespace std;
+
+namespace {
+
+// 8-point Gauss-Legendre nodes and weights on [-1,1]
+const double gl_x[4] = {
+  0.1834346424956498, 0.5255324099163290,
+  0.7966664774136267, 0.9602898564975363 };
+const double gl_w[4] = {
+  0.3626837833783620, 0.3137066458778873,
+  0.2223810344533745, 0.1012285362903763 };
+
+double quadrature(double p0, double p1, double m1, double m2) noexcept {
+  const double c = 0.5*(m1+m2), h = 0.5*(m2-m1);
+  double sum = 0.;
+  for (int i=0; i<4; ++i)
+    for (double m : { c-h*gl_x[i], c+h*gl_x[i] })
+      sum += gl_w[i]*exp(p0*m - p1*m*m);
+  return sum*h;
+}
+
+}
+
+vector<double> exp2_integrals(
+  double p0, double p1, const vector<double>& edges
+) {
+  const size_t n = edges.size()-1;
+  vector<double> v(n);
+  if (!(p1 > 0.)) {
+    for (size_t i=0; i<n; ++i)
+      v[i] = quadrature(p0,p1,
+        (edges[i]-100.)/100., (edges[i+1]-100.)/100.);
+    return v;
+  }
+
+  // exp(p0*m - p1*m^2) = const * exp(-u^2), u = sqrt(p1)*(m - p0/(2*p1)),
+  // constant factors are dropped. erfc is used on the side of the peak
+  // where the erf difference would cancel.
+  const double s = sqrt(p1), m0 = p0/(2.*p1);
+  auto u = [=](double x){ return s*((x-100.)/100. - m0); };
+  double u1 = u(edges[0]);
+  for (size_t i=0; i<n; ++i) {
+    const double u2 = u(edges[i+1]);
+    v[i] = u1 >= 0. ? erfc(u1) - erfc(u2)
+         : u2 <= 0. ? erfc(-u2) - erfc(-u1)
+         : erf(u2) - erf(u1);
+    u1 = u2;
+  }
+  return v;
+}
+
+const TH1* exp2_template(double p0, double p1, const TAxis& axis, double norm)
+{
+  const int n = axis.GetNbins();
+  vector<double> edges(n+1);
+  for (int i=0; i<n; ++i) edges[i] = axis.GetBinLowEdge(i+1);
+  edges[n] = axis.GetBinUpEdge(n);
+
+  using key_t = tuple<double,double,double,vector<double>>;
+  static map<key_t,unique_ptr<TH1>> cache;
+
+  key_t key { p0, p1, norm, move(edges) };
+  auto it = cache.find(key);
+  if (it!=cache.end()) return it->second.get();
+
+  const vector<double>& e = get<3>(key);
+  const auto v = exp2_integrals(p0,p1,e);
+  double total = 0.;
+  for (double x : v) total += x;
+  if (!(total > 0. && std::isfinite(total))) throw runtime_error(cat(
+    "exp2 background with p0 = ",p0,", p1 = ",p1,
+    " does not integrate over [",e.front(),',',e.back(),']'));
+
+  TH1 *h = new TH1D(cat("hexp2_",cache.size()).c_str(),
+    ";m_{#gamma#gamma} [GeV];N Events", n, e.data());
+  h->SetDirectory(nullptr);
+  const double f = norm/total;
+  for (int i=0; i<n; ++i) h->SetBinContent(i+1,f*v[i]);
+
+  return cache.emplace(move(key),unique_ptr<TH1>(h)).first->second.get();
+}
@@ -0,0 +1,24 @@
+#ifndef bg_template_hh
+#define bg_template_hh
+
+#include <vector>
+
+class TH1;
+class TAxis;
+
+// Integrals of the exp2 background shape, exp(p0*m - p1*m^2)
+// with m = (x-100)/100 and x = m_yy in GeV, over bins with the given
+// edges, in arbitrary units common to all bins.
+// For p1 > 0 the shape is a gaussian and the integrals are
+// differences of erfc, otherwise they are computed by
+// Gauss-Legendre quadrature in every bin.
+std::vector<double> exp2_integrals(
+  double p0, double p1, const std::vector<double>& edges);
+
+// Histogram with the binning of axis of the expected exp2 background
+// counts per bin, normalized to norm over the range of the axis.
+// Templates are memoized on (p0, p1, bin edges, norm) and owned
+// by the cache, so repeated calls, e.g. for toys, cost a lookup.
+const TH1* exp2_template(double p0, double p1, const TAxis& axis, double norm);
+
+#endif
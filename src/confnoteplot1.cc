@@ -19,6 +19,9 @@
 #include "val_err.hh"
 #include "TGraph_fcns.hh"
 #include "golden_min.hh"
+#include "results.hh"
+#include "variations.hh"
+#include "run_report.hh"
 
 using namespace std;
 
@@ -30,31 +33,48 @@ structmap(val_err<double>,hist_t,
 
 int main(int argc, char** argv)
 {
-  if (argc!=3 && argc!=4) {
-    cout << "usage: " << argv[0] << " in.root out.pdf [minsig]" << endl;
+  if (argc<3 || argc>6) {
+    cout << "usage: " << argv[0]
+         << " in.root out.pdf [minsig] [results.{ndjson,pesr}]"
+            " [report.json]" << endl;
     return 0;
   }
+  bool minsig = false;
+  const char* rfname = nullptr;
+  for (int i=3; i<argc; ++i) {
+    const string arg(argv[i]);
+    if (arg=="minsig") minsig = true;
+    else if (arg.size()>5 && !arg.compare(arg.size()-5,5,".json"))
+      run_report::write_at_exit(arg,argv[0]);
+    else rfname = argv[i];
+  }
 
-  TFile *fin = new TFile(argv[1],"read");
-  if (fin->IsZombie()) return 1;
-
+  TFile *fin;
   seqmap<hist_t> stats;
+  TH1    *h_nominal;
+  TGraph *f_nominal;
   {
-    TTree *tree = get<TTree>(fin,"stats");
-    auto *branches = tree->GetListOfBranches();
-    stats.reserve(branches->GetEntries());
-    for (auto x : *branches) {
-      //cout << "Branch: " << x->GetName() << endl;
-      tree->SetBranchAddress(x->GetName(),&stats[x->GetName()]);
+    timed_stage stage("read");
+    fin = new TFile(argv[1],"read");
+    if (fin->IsZombie()) return 1;
+
+    if (rfname) {
+      fill_stats(stats, read_results(rfname, {
+        "mean_offset_bin0", "sigma_offset_bin0", "crys_alpha_bin0",
+        "crys_norm_bin0", "gaus_mean_offset_bin0", "gaus_kappa_bin0",
+        "fcb_bin0", "FWHM"
+      }));
+    } else {
+      fill_stats(stats, read_stats_tree(get<TTree>(fin,"stats")));
     }
-    tree->GetEntry(0);
-  }
 
-  TH1    *h_nominal = get<TH1>   (fin,"nominal");
-  TGraph *f_nominal = get<TGraph>(fin,"nominal_fit");
+    h_nominal = get<TH1>   (fin,"nominal");
+    f_nominal = get<TGraph>(fin,"nominal_fit");
+  }
 
   // DRAW ************************************************
 
+  timed_stage stage("draw");
   TCanvas canv;
   canv.SetMargin(0.07,0.04,0.1,0.02);
   // canv.SetLogy();
@@ -142,7 +162,7 @@ int main(int argc, char** argv)
 
   const Double_t integral = integrate(f_nominal);
 
-  if (argc==4 && string("minsig")==argv[3]) {
+  if (minsig) {
     golden_min gm;
 
     for (auto frac : {0.68,0.90}) {
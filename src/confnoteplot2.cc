@@ -25,9 +25,12 @@
 #include "catstr.hh"
 #include "root_safe_get.hh"
 #include "TGraph_fcns.hh"
-#include "binned.hh"
+#include "grid.hh"
+#include "hist_bank.hh"
 #include "workspace.hh"
 #include "golden_min.hh"
+#include "pages.hh"
+#include "fork_pool.hh"
 
 using namespace std;
 namespace po = boost::program_options;
@@ -35,11 +38,6 @@ namespace po = boost::program_options;
 #define test(var) \
   std::cout <<"\033[36m"<< #var <<"\033[0m"<< " = " << var << std::endl;
 
-template<typename T, typename ...Args>
-std::unique_ptr<T> make_unique( Args&& ...args ) {
-  return std::unique_ptr<T>( new T( std::forward<Args>(args)... ) );
-}
-
 namespace std {
   template <typename T1, typename T2>
   istream& operator>>(istream& in, pair<T1,T2>& p) {
@@ -64,6 +62,7 @@ public:
     tree->SetBranchAddress(branch.c_str(), x);
     names.emplace_back(branch);
   }
+  void enable(const string& branch) { names.emplace_back(branch); }
   ~branches_manager() {
     tree->SetBranchStatus("*",0);
     for (const auto& name : names)
@@ -82,6 +81,11 @@ int main(int argc, char** argv)
   vector<pair<string,pair<double,double>>> new_ws_ranges;
   double sigma_frac;
   pair<int,pair<double,double>> vert;
+  vector<string> grid_axes;
+  vector<unsigned> page_nums;
+  unsigned njobs;
+  string report_fname;
+  vector<string> split;
 
   // options ---------------------------------------------------
   try {
@@ -98,8 +102,12 @@ int main(int argc, char** argv)
 
       ("sigma-frac,s", po::value(&sigma_frac)->default_value(0.68,"0.68"),
        "confidence interval fraction")
-      ("vert,v", po::value(&vert)->required(),
-       "num vertices binning")
+      ("vert,v", po::value(&vert),
+       "num vertices binning, nbins:min:step")
+      ("grid,g", po::value(&grid_axes)->multitoken(),
+       "more binning axes, [name=]expr:nbins:min:max,\n"
+       "expr is any TTree formula, e.g. HGamPhotonsAuxDyn.eta[0];\n"
+       "all axes are filled in one pass over the events")
       ("nbins,b", po::value(&nbins)->default_value(100),
        "histograms\' number of bins")
       ("xrange,x", po::value(&xrange)->default_value({105,140},"105:140"),
@@ -110,6 +118,17 @@ int main(int argc, char** argv)
         default_value(decltype(colors)({602,46}), "{602,46}"),
        "histograms\' colors")
 
+      ("pages,p", po::value(&page_nums)->multitoken(),
+       "write only these pages, numbered from 1")
+      ("jobs,j", po::value(&njobs)->default_value(4),
+       "number of worker processes fitting, drawing pdf pages\n"
+       "and evaluating simultaneous fit categories")
+      ("split", po::value(&split)->multitoken(),
+       "fit all grid cells in one likelihood, with these parameters\n"
+       "per cell and the others shared, e.g. sigma_offset_bin0")
+      ("report", po::value(&report_fname),
+       "write JSON report of stage timing and counters at exit")
+
       ("ws-setRange", po::value(&new_ws_ranges),
        "call RooWorkspace::setRange()")
     ;
@@ -134,6 +153,8 @@ int main(int argc, char** argv)
     if (ofext!="pdf") throw runtime_error(
       "Output file extension "+ofext+" is not pdf"
     );
+    if (!vm.count("vert") && grid_axes.empty()) throw runtime_error(
+      "no binning, use --vert or --grid");
 
   } catch (exception& e) {
     cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
@@ -141,41 +162,45 @@ int main(int argc, char** argv)
   }
   // end options ---------------------------------------------------
 
-  // Book histograms ************************************************
-  constexpr auto hist_types = {"selected"};
-  binned<vector<pair<TH1*,unique_ptr<TH1>>>>
-    hmap(vert.first,vert.second.first,vert.second.second);
+  if (!report_fname.empty()) run_report::write_at_exit(report_fname,argv[0]);
 
-  for (size_t i=0, n=hmap.nbins()+1; i<=n; ++i) {
-    auto& hs = hmap.at(i);
-    hs.reserve(hist_types.size());
-    for (const auto *hist_type : hist_types) {
-      string name;
-      if (i==0) name = cat(
-        hist_type,"_m_yy_nvert<",hmap.right_edge(i)
-      ); else if (i==n) name = cat(
-        hist_type,"_m_yy_nvert>",hmap.left_edge(i)
-      ); else name = cat(
-        hist_type,"_m_yy_nvert[",hmap.left_edge(i),',',hmap.right_edge(i),')'
-      );
-      hs.emplace_back(
-        new TH1D( name.c_str(),
-          ";m_{#gamma#gamma} [GeV];d#sigma/dm_{#gamma#gamma} [fb/GeV]",
-          nbins,xrange.first,xrange.second),
-        make_unique<TH1D>("tmp_hist","",nbins,xrange.first,xrange.second)
-      );
-      hs.back().second->SetDirectory(0);
-    }
+  // Binning grid *************************************************
+  vector<grid_axis> axes;
+  if (vert.first > 0) {
+    axes.push_back({"nvert","HGamEventInfoAuxDyn.numberOfPrimaryVertices",
+                    "Number primary vertices",{vert.second.first}});
+    for (int i=0; i<vert.first; ++i)
+      axes.back().edges.push_back(axes.back().edges.back()+vert.second.second);
+  }
+  try {
+    for (const auto& a : grid_axes) axes.push_back(grid_axis::parse(a));
+  } catch (exception& e) {
+    cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
+    return 1;
   }
+  const grid g(move(axes));
 
-  cout << "Histograms:" << endl;
-  for (const auto& hs : hmap)
-    for (const auto& h : hs)
-      cout << "  " << h.first->GetName() << endl;
-  cout << endl;
+  // Book histograms ************************************************
+  // The bins of all cells and hist types are in one bank,
+  // cell*hist_types.size() + hist type, and TH1s are made
+  // from it for the cells that are fitted or drawn
+  constexpr auto hist_types = {"selected"};
+  hist_bank bank(g.size()*hist_types.size(),
+                 nbins,xrange.first,xrange.second);
+  vector<unique_ptr<TH1>> hists(bank.size());
+  auto hist = [&](size_t cell, size_t type) -> TH1* {
+    auto& h = hists[cell*hist_types.size()+type];
+    if (!h) h.reset(bank.hist(cell*hist_types.size()+type,
+      cat(*(hist_types.begin()+type),"_m_yy_",g.label(cell)).c_str(),
+      ";m_{#gamma#gamma} [GeV];d#sigma/dm_{#gamma#gamma} [fb/GeV]"));
+    return h.get();
+  };
+
+  cout << "Histograms: " << bank.size() << endl << endl;
 
   // LOOP over input files ******************************************
   for (const string& f : ifname) {
+    timed_stage stage("read");
     TFile *file = new TFile(f.c_str(),"read");
     if (file->IsZombie()) return 1;
     cout << "Data file: " << f << endl;
@@ -185,6 +210,7 @@ int main(int argc, char** argv)
     const double xsecscale = 1e3/get<TH1>(file,
       ("CutFlow_"+f.substr(slash,f.find('.')-slash)+"_weighted").c_str()
     )->GetBinContent(3);
+    bank.set_scale(xsecscale*nbins/(xrange.second-xrange.first));
 
     // Regex for process identification
     static regex proc_re(".*[\\._]?(gg.|VBF|ttH|WH|ZH)[0-9]*[\\._]?.*",
@@ -200,42 +226,39 @@ int main(int argc, char** argv)
       throw runtime_error(cat("File \"",f,"\" repeats process ",proc));
 
     // Branch variables
-    static array<pair<Float_t,Int_t>,hist_types.size()> var;
+    static array<Float_t,hist_types.size()> m_yy;
     static Float_t crossSectionBRfilterEff;//, weight;
     static Char_t isPassed;
+    grid_reader cells(g,tree);
     {
       branches_manager br(tree);
 
-      br("HGamEventInfoAuxDyn.m_yy", &var.at(0).first);
-      br("HGamEventInfoAuxDyn.numberOfPrimaryVertices", &var.at(0).second);
+      br("HGamEventInfoAuxDyn.m_yy", &m_yy.at(0));
 
       br("HGamEventInfoAuxDyn.crossSectionBRfilterEff",
          &crossSectionBRfilterEff);
       // br("HGamEventInfoAuxDyn.weight", &weight);
       br("HGamEventInfoAuxDyn.isPassed", &isPassed);
-    }
 
-    // LOOP over tree entries
-    for (Long64_t nent=tree->GetEntries(), ent=0; ent<nent; ++ent) {
-      tree->GetEntry(ent);
-
-      for (size_t i=0; i<var.size(); ++i) {
-        if (isPassed==1)
-          hmap[var[i].second][i].second->Fill(
-            var[i].first/1e3,
-            crossSectionBRfilterEff//*weight
-          );
-      }
+      for (const auto& branch : cells.branches()) br.enable(branch);
     }
 
-    // Add histograms
-    for (auto it=hmap.begin(), end=hmap.end(true); it!=end; ++it) {
-      for (const auto& h : *it) {
-        h.second->Scale(xsecscale/h.second->GetBinWidth(1));
-        h.first->Add(h.second.get());
-        h.second->Reset();
-      }
+    // LOOP over tree entries
+    const Long64_t nent = tree->GetEntries();
+    unsigned long long nbytes = 0;
+    for (Long64_t ent=0; ent<nent; ++ent) {
+      nbytes += tree->GetEntry(ent);
+      if (isPassed!=1) continue;
+
+      const size_t cell = cells.cell();
+      for (size_t i=0; i<m_yy.size(); ++i)
+        bank.fill(cell*hist_types.size()+i,
+          m_yy[i]/1e3,
+          crossSectionBRfilterEff//*weight
+        );
     }
+    run_report::count_bytes(nbytes);
+    run_report::count_events(nent);
 
     delete file;
   }
@@ -244,14 +267,67 @@ int main(int argc, char** argv)
   workspace ws(wfname);
   golden_min gm;
 
-  vector<array<tuple<TGraph*,double,double>,hist_types.size()>> fits;
-  fits.reserve(hmap.nbins());
+  vector<size_t> inner; // cells without underflow or overflow bins
+  for (size_t c=0; c<g.size(); ++c)
+    if (g.inner(c)) inner.push_back(c);
+
+  // Fitted curves [cell][hist type] of the inner cells,
+  // from a fit per histogram, or from a simultaneous fit
+  // of all cells per hist type
+  vector<array<TGraph*,hist_types.size()>> curves(g.size());
+  if (split.empty()) {
+    // the histograms are fitted in a batch on a pool of workers,
+    // every one from the workspace as loaded, not from the previous
+    // fit of the worker, and curves are sent back as x,y points
+    timed_stage stage("fits");
+    const size_t ntypes = hist_types.size();
+    const auto start = ws.save();
+    fit_options opt;
+    opt.verbose = njobs < 2;
+    if (njobs > 1) opt.ncpu = 1;
+    const auto flats = fork_map(inner.size()*ntypes, njobs, [&](size_t j){
+      ws.restore(start);
+      const TGraph *gr = ws.fit(hist(inner[j/ntypes],j%ntypes),opt).second;
+      vector<double> flat;
+      flat.reserve(2*gr->GetN());
+      for (int p=0, n=gr->GetN(); p<n; ++p) {
+        flat.push_back(gr->GetX()[p]);
+        flat.push_back(gr->GetY()[p]);
+      }
+      return string(reinterpret_cast<const char*>(flat.data()),
+                    flat.size()*sizeof(double));
+    });
+    for (size_t j=0; j<flats.size(); ++j) {
+      const double *xy = reinterpret_cast<const double*>(flats[j].data());
+      const int n = flats[j].size()/(2*sizeof(double));
+      TGraph *fit_gr = new TGraph(n);
+      for (int p=0; p<n; ++p) fit_gr->SetPoint(p,xy[2*p],xy[2*p+1]);
+      fit_gr->SetName(cat(hist(inner[j/ntypes],j%ntypes)->GetName(),
+                          "_fit").c_str());
+      curves[inner[j/ntypes]][j%ntypes] = fit_gr;
+    }
+  } else {
+    timed_stage stage("simultaneous fits");
+    fit_options opt;
+    opt.ncpu = njobs;
+    for (size_t i=0; i<hist_types.size(); ++i) {
+      vector<TH1*> bin_hists;
+      for (size_t c : inner) bin_hists.push_back(hist(c,i));
+      const auto fit = ws.fit_bins(bin_hists,split,opt);
+      for (size_t b=0; b<inner.size(); ++b) {
+        TGraph* fit_gr = fit.second[b];
+        fit_gr->SetName(cat(bin_hists[b]->GetName(),"_fit").c_str());
+        curves[inner[b]][i] = fit_gr;
+      }
+    }
+  }
+
+  vector<array<tuple<TGraph*,double,double>,hist_types.size()>>
+    fits(g.size());
 
-  for (const auto& hs : hmap) {
+  for (size_t c : inner) {
     size_t i=0;
-    fits.emplace_back();
-    for (const auto& h : hs) {
-      TGraph* fit_gr = ws.fit(h.first).second;
+    for (TGraph* fit_gr : curves[c]) {
       const Double_t integral = integrate(fit_gr);
       // minimize sigma
       Double_t x1 = gm( [fit_gr,sigma_frac,integral](double x1) {
@@ -259,116 +335,151 @@ int main(int argc, char** argv)
       }, firstx(fit_gr), rtailx(fit_gr,sigma_frac,integral) ).first;
       Double_t x2 = intervalx2(fit_gr, sigma_frac, x1, integral);
 
-      fit_gr->SetName(cat(h.first->GetName(),"_fit").c_str());
-      fits.back()[i++] = make_tuple(fit_gr,x1,x2);
+      fits[c][i++] = make_tuple(fit_gr,x1,x2);
     }
   }
 
-  // Draw histograms ************************************************
-  TCanvas canv;
-  canv.SetMargin(0.08,0.04,0.1,0.02);
-  canv.SetTicks();
-
-  TLatex lbl;
-  lbl.SetTextFont(43);
-  lbl.SetTextSize(18);
-  lbl.SetNDC();
-
-  TLine line;
-
-  canv.SaveAs((ofname+'[').c_str());
+  // Summary histograms *********************************************
+  // sigma against the first axis, per hist type and
+  // per inner bin of the other axes
+  const grid_axis& axis0 = g.axes().front();
+  struct summary_hist {
+    TH1 *h;
+    size_t type;
+    string lbl; // bins of the other axes
+  };
+  vector<summary_hist> summary;
+  for (size_t c : inner) {
+    auto bins = g.bins(c);
+    if (bins[0]!=1) continue;
+    string lbl;
+    for (size_t a=1; a<bins.size(); ++a)
+      lbl += (a>1 ? "_" : "") + g.axes()[a].label(bins[a]);
 
-  // Summary plot
-  array<TH1*,hist_types.size()> hists; hists.fill(nullptr);
-  for (const auto& fit : fits) {
-    static int b=0;
-    int h=0;
+    size_t i=0;
     for (const auto *hist_type : hist_types) {
-      if (b==0) hists[h] = new TH1D(
-        hist_type,
-        cat(";Number primary vertices;"
+      TH1 *h = new TH1D(
+        cat(hist_type,(lbl.empty() ? "" : "_"),lbl).c_str(),
+        cat(';',axis0.title,";"
             "#sigma_{",sigma_frac*100,"} [GeV]").c_str(),
-        hmap.nbins(),hmap.get_bins().data());
-      hists[h]->SetBinContent(b+1,(get<2>(fit[h])-get<1>(fit[h]))/2.);
-      ++h;
+        axis0.nbins(),axis0.edges.data());
+      for (int b=1; b<=axis0.nbins(); ++b) {
+        bins[0] = b;
+        const auto& fit = fits[g.cell(bins)][i];
+        h->SetBinContent(b,(get<2>(fit)-get<1>(fit))/2.);
+      }
+      summary.push_back({h,i,lbl});
+      bins[0] = 1;
+      ++i;
     }
-    ++b;
   }
 
-  TLegend leg(0.12,0.67,0.45,0.76);
-  array<const char*,hist_types.size()> leg_lbl {
-    "Selected vertex"
+  // Draw histograms ************************************************
+  auto setup = [](TCanvas& canv){
+    canv.SetMargin(0.08,0.04,0.1,0.02);
+    canv.SetTicks();
+  };
+  auto make_lbl = []{
+    TLatex lbl;
+    lbl.SetTextFont(43);
+    lbl.SetTextSize(18);
+    lbl.SetNDC();
+    return lbl;
   };
 
-  for (auto* h : hists) {
-    static int i=0;
-    Color_t color = colors[i % colors.size()];
-    h->SetStats(false);
-    h->SetLineWidth(2);
-    h->GetYaxis()->SetTitleOffset(1.05);
-    h->SetLineColor(color);
-    h->SetMarkerColor(color);
-    // h->SetMarkerStyle(20+i);
-    h->Draw(i ? "same" : "");
-    if (i==0) {
-      leg.AddEntry(h,leg_lbl[i]);
-      double lxmin = 0.12;
-      double ly = 0.9;
-      lbl.DrawLatex(lxmin,ly,"ATLAS")->SetTextFont(73);
-      lbl.DrawLatex(lxmin+0.095,ly,"Internal");
-      lbl.DrawLatex(lxmin,ly-=0.06,"#it{#sqrt{s}} = 13 TeV");
-      lbl.DrawLatex(lxmin,ly-=0.06,
-        "#it{H#rightarrow#gamma#gamma}, #it{m_{H}} = 125 GeV");
-    }
-    ++i;
-  }
-
-  leg.SetBorderSize(0);
-  leg.SetFillStyle(0);
-  leg.Draw();
+  vector<page_t> pages;
 
-  canv.SaveAs(ofname.c_str());
+  // Summary plot
+  pages.emplace_back([&](TCanvas& canv){
+    setup(canv);
+    TLatex lbl = make_lbl();
 
-  // Histograms in vertex bins
-  if (logy) canv.SetLogy();
+    // owned by the pad, the page is saved after this function returns
+    TLegend *leg = new TLegend(0.12,0.67,0.45,0.76);
+    leg->SetBit(TObject::kCanDelete);
+    array<const char*,hist_types.size()> leg_lbl {
+      "Selected vertex"
+    };
 
-  for (size_t b=1, n=hmap.nbins(); b<=n+1; ++b) {
-    Color_t color;
     int i=0;
-    for (const auto& hp : hmap.at(b)) {
-      TH1* h = hp.first;
+    for (const auto& sh : summary) {
+      TH1 *h = sh.h;
+      Color_t color = colors[i % colors.size()];
       h->SetStats(false);
       h->SetLineWidth(2);
       h->GetYaxis()->SetTitleOffset(1.05);
-      h->SetLineColor(color = colors[i % colors.size()]);
+      h->SetLineColor(color);
+      h->SetMarkerColor(color);
+      // h->SetMarkerStyle(20+i);
       h->Draw(i ? "same" : "");
-      const auto& fit = fits[b-1][i];
-      if (b<=n) {
-        get<0>(fit)->Draw("same");
-        canv.Update();
-        double y1 = canv.GetUymin();
-        double y2 = canv.GetUymax();
-        if (logy) {
-          y1 = pow(10.,y1);
-          y2 = pow(10.,y2);
+      leg->AddEntry(h,sh.lbl.empty() ? leg_lbl[sh.type]
+                                     : cat(leg_lbl[sh.type],' ',sh.lbl).c_str());
+      if (i==0) {
+        double lxmin = 0.12;
+        double ly = 0.9;
+        lbl.DrawLatex(lxmin,ly,"ATLAS")->SetTextFont(73);
+        lbl.DrawLatex(lxmin+0.095,ly,"Internal");
+        lbl.DrawLatex(lxmin,ly-=0.06,"#it{#sqrt{s}} = 13 TeV");
+        lbl.DrawLatex(lxmin,ly-=0.06,
+          "#it{H#rightarrow#gamma#gamma}, #it{m_{H}} = 125 GeV");
+      }
+      ++i;
+    }
+
+    leg->SetBorderSize(0);
+    leg->SetFillStyle(0);
+    leg->Draw();
+  });
+
+  // Histograms in grid cells, but underflow
+  for (size_t c=0; c<g.size(); ++c) {
+    if (g.underflow(c)) continue;
+    pages.emplace_back([&,c](TCanvas& canv){
+      setup(canv);
+      canv.SetLogy(logy);
+      TLatex lbl = make_lbl();
+      TLine line;
+
+      Color_t color;
+      for (size_t i=0; i<hist_types.size(); ++i) {
+        TH1* h = hist(c,i);
+        h->SetStats(false);
+        h->SetLineWidth(2);
+        h->GetYaxis()->SetTitleOffset(1.05);
+        h->SetLineColor(color = colors[i % colors.size()]);
+        h->Draw(i ? "same" : "");
+        if (g.inner(c)) {
+          const auto& fit = fits[c][i];
+          get<0>(fit)->Draw("same");
+          canv.Update();
+          double y1 = canv.GetUymin();
+          double y2 = canv.GetUymax();
+          if (logy) {
+            y1 = pow(10.,y1);
+            y2 = pow(10.,y2);
+          }
+          line.DrawLine(get<1>(fit), y1, get<1>(fit), y2)->SetLineColor(color);
+          line.DrawLine(get<2>(fit), y1, get<2>(fit), y2)->SetLineColor(color);
         }
-      	line.DrawLine(get<1>(fit), y1, get<1>(fit), y2)->SetLineColor(color);
-      	line.DrawLine(get<2>(fit), y1, get<2>(fit), y2)->SetLineColor(color);
 
-        canv.Update();
-        TLine line(canv.GetUxmax(),canv.GetUymin(),canv.GetUxmin(),canv.GetUymax());
-        line.Draw();
+        lbl.DrawLatex(0.12,0.9-0.05*i,h->GetName())->SetTextColor(color);
+        lbl.DrawLatex(0.80,0.9-0.05*i,
+          cat(h->GetEntries()).c_str())->SetTextColor(color);
       }
+    });
+  }
 
-      lbl.DrawLatex(0.12,0.9-0.05*i,h->GetName())->SetTextColor(color);
-      lbl.DrawLatex(0.80,0.9-0.05*i,
-        cat(h->GetEntries()).c_str())->SetTextColor(color);
-      ++i;
+  if (!page_nums.empty()) {
+    vector<page_t> selected;
+    for (unsigned p : page_nums) {
+      if (p<1 || p>pages.size()) throw out_of_range(cat(
+        "page ",p," is not in [1,",pages.size(),"]"));
+      selected.push_back(pages[p-1]);
     }
-    canv.SaveAs(ofname.c_str());
+    pages.swap(selected);
   }
 
-  canv.SaveAs((ofname+']').c_str());
+  save_pages(ofname,pages,njobs);
 
   return 0;
 }
@@ -0,0 +1,68 @@
+#include "events.hh"
+
+#include <cmath>
+#include <limits>
+
+#include <TTree.h>
+#include <TH1.h>
+
+using namespace std;
+
+event_store::event_store(vector<variation> vars)
+: vars(move(vars)), m_yy(this->vars.size()) { }
+
+void event_store::read(TTree* tree, double scale) {
+  const size_t nvars = vars.size();
+  vector<Float_t> m(nvars, numeric_limits<Float_t>::quiet_NaN());
+  Float_t crossSectionBRfilterEff, w;
+  Char_t isPassed;
+
+  auto *branches = tree->GetListOfBranches();
+  tree->SetBranchStatus("*",0);
+  auto addr = [tree](const string& branch, void* x){
+    tree->SetBranchStatus(branch.c_str(),1);
+    tree->SetBranchAddress(branch.c_str(),x);
+  };
+  addr("HGamEventInfoAuxDyn.crossSectionBRfilterEff",&crossSectionBRfilterEff);
+  addr("HGamEventInfoAuxDyn.weight",&w);
+  addr("HGamEventInfoAuxDyn.isPassed",&isPassed);
+  for (size_t i=0; i<nvars; ++i)
+    if (branches->Contains(vars[i].branch.c_str()))
+      addr(vars[i].branch,&m[i]);
+
+  // LOOP over tree entries
+  const Long64_t nent = tree->GetEntries();
+  unsigned long long nbytes = 0;
+  for (Long64_t ent=0; ent<nent; ++ent) {
+    nbytes += tree->GetEntry(ent);
+    if (isPassed!=1) continue;
+    weight.push_back(1000.*scale*crossSectionBRfilterEff*w);
+    for (size_t i=0; i<nvars; ++i) m_yy[i].push_back(m[i]/1000);
+  }
+  run_report::count_bytes(nbytes);
+  run_report::count_events(nent);
+}
+
+TH1* event_store::hist(size_t i, int nbins, double xmin, double xmax) const {
+  const char *name = vars[i].name.c_str();
+  return fill(i,new TH1D(name,name,nbins,xmin,xmax));
+}
+
+TH1* event_store::hist(size_t i, const vector<double>& edges) const {
+  const char *name = vars[i].name.c_str();
+  return fill(i,new TH1D(name,name,edges.size()-1,edges.data()));
+}
+
+TH1* event_store::fill(size_t i, TH1* h) const {
+  h->SetDirectory(0);
+  h->Sumw2();
+  h->SetXTitle("m_{#gamma#gamma} [GeV]");
+  h->SetYTitle("d#sigma/dm_{#gamma#gamma} [fb/GeV]");
+
+  const auto& m = m_yy[i];
+  for (size_t e=0, n=weight.size(); e<n; ++e)
+    if (!std::isnan(m[e])) h->Fill(m[e],weight[e]);
+  if (h->GetXaxis()->IsVariableBinSize()) h->Scale(1.,"width");
+  else h->Scale(1./h->GetBinWidth(1));
+  return h;
+}
@@ -0,0 +1,44 @@
+#ifndef events_hh
+#define events_hh
+
+#include <string>
+#include <vector>
+
+#include "variations.hh"
+#include "run_report.hh"
+
+class TTree;
+class TH1;
+
+// Selected events of every variation, kept in memory as compact columns,
+// so that histograms with any binning can be refilled
+// without reading the input files again.
+// All variations share the nominal selection and event weights.
+class event_store {
+  std::vector<variation> vars;
+  std::vector<float> weight;            // [event], fb
+  std::vector<std::vector<float>> m_yy; // [variation][event], GeV
+
+  TH1* fill(size_t i, TH1* h) const;
+
+public:
+  explicit event_store(std::vector<variation> vars);
+
+  // Append the selected events of a tree,
+  // scale converts event weights to cross section in fb.
+  // m_yy of variations missing from the tree is NaN.
+  void read(TTree* tree, double scale);
+
+  const std::vector<variation>& variations() const noexcept { return vars; }
+  size_t size() const noexcept { return weight.size(); }
+
+  // Columns for unbinned fits, weights in fb, m_yy in GeV
+  const std::vector<float>& weights() const noexcept { return weight; }
+  const std::vector<float>& masses(size_t i) const noexcept { return m_yy[i]; }
+
+  // d(sigma)/dm_yy histogram of variation i, not owned by any directory
+  TH1* hist(size_t i, int nbins, double xmin, double xmax) const;
+  TH1* hist(size_t i, const std::vector<double>& edges) const;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "fit_plan.hh"
+
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <algorithm>
+
+#include <TH1.h>
+#include <TGraph.h>
+
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooArgList.h>
+#include <RooFitResult.h>
+
+using namespace std;
+
+vector<fit_job_result> run_fit_plan(
+  workspace& ws, const vector<fit_job>& jobs, unsigned njobs
+) {
+  // Distinct fits, keyed by histogram and the fixed values that matter
+  using fit_key = pair<const TH1*,vector<pair<string,double>>>;
+  map<fit_key,size_t> keys;
+  vector<size_t> fit_of(jobs.size()); // job -> fit
+  vector<size_t> first_job;           // fit -> job
+  vector<vector<string>> extract;     // fit -> parameters of all its jobs
+  for (size_t j=0; j<jobs.size(); ++j) {
+    fit_key key { jobs[j].hist, { } };
+    for (const auto& f : jobs[j].fixed)
+      if (ws.depends_on(f.first.c_str())) key.second.push_back(f);
+    sort(key.second.begin(),key.second.end());
+    const auto it = keys.emplace(move(key),first_job.size());
+    if (it.second) {
+      first_job.push_back(j);
+      extract.emplace_back();
+    }
+    fit_of[j] = it.first->second;
+    auto& names = extract[fit_of[j]];
+    for (const auto& name : jobs[j].extract)
+      if (find(names.begin(),names.end(),name)==names.end())
+        names.push_back(name);
+  }
+  cout << "Fit plan: " << jobs.size() << " jobs, "
+       << first_job.size() << " distinct fits" << endl;
+
+  const auto init = ws.save();
+
+  fit_options opt;
+  opt.verbose = njobs < 2;
+  if (njobs > 1) opt.ncpu = 1;
+
+  // A fit is sent back as flat doubles: status,
+  // val,err of every extracted parameter, the curve's x,y points
+  const auto flats = fork_map(first_job.size(), njobs, [&](size_t i){
+    ws.restore(init);
+    const fit_job& job = jobs[first_job[i]];
+    for (const auto& f : job.fixed) // others aren't in a pruned workspace
+      if (ws.depends_on(f.first.c_str()))
+        ws.fixVal(f.first.c_str(),f.second);
+
+    auto fit = ws.fit(job.hist,opt);
+    vector<double> flat { double(fit.first->status()) };
+    for (const auto& name : extract[i]) {
+      const RooRealVar *var = static_cast<const RooRealVar*>(
+        fit.first->floatParsFinal().find(name.c_str()));
+      if (!var) var = static_cast<const RooRealVar*>(
+        fit.first->constPars().find(name.c_str()));
+      flat.push_back(var ? var->getVal() : NAN);
+      flat.push_back(var ? var->getError() : NAN);
+    }
+    const TGraph *curve = fit.second;
+    for (int p=0, n=curve->GetN(); p<n; ++p) {
+      flat.push_back(curve->GetX()[p]);
+      flat.push_back(curve->GetY()[p]);
+    }
+    return string(reinterpret_cast<const char*>(flat.data()),
+                  flat.size()*sizeof(double));
+  });
+
+  // Curves are shared by the jobs of the same fit
+  vector<TGraph*> curves(first_job.size());
+  vector<fit_job_result> results;
+  results.reserve(jobs.size());
+  for (size_t j=0; j<jobs.size(); ++j) {
+    const size_t f = fit_of[j];
+    const double *flat = reinterpret_cast<const double*>(flats[f].data());
+    const size_t n = flats[f].size()/sizeof(double);
+    const auto& names = extract[f];
+    const size_t npars = names.size();
+
+    if (!curves[f]) {
+      const int np = (n-1-2*npars)/2;
+      curves[f] = new TGraph(np);
+      for (int p=0; p<np; ++p)
+        curves[f]->SetPoint(p,flat[1+2*(npars+p)],flat[2+2*(npars+p)]);
+    }
+
+    fit_job_result res { int(flat[0]), { }, curves[f] };
+    for (const auto& name : jobs[j].extract) {
+      const size_t k = find(names.begin(),names.end(),name)-names.begin();
+      res.pars.emplace_back(flat[1+2*k],flat[2+2*k]);
+    }
+    results.push_back(move(res));
+  }
+
+  ws.restore(init); // leave the workspace as it was
+
+  return results;
+}
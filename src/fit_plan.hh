@@ -0,0 +1,39 @@
+#ifndef fit_plan_hh
+#define fit_plan_hh
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "val_err.hh"
+#include "workspace.hh"
+#include "fork_pool.hh"
+
+class TH1;
+class TGraph;
+
+// A fit of a histogram with some parameters fixed,
+// and the parameters to extract from it
+struct fit_job {
+  TH1 *hist;
+  std::vector<std::pair<std::string,double>> fixed;
+  std::vector<std::string> extract;
+};
+
+struct fit_job_result {
+  int status;
+  std::vector<val_err<double>> pars; // in extract order
+  TGraph *curve;
+};
+
+// Run a fit plan. Every job starts from the workspace variables
+// as they are when run_fit_plan is called, fixing only its own
+// parameters, so jobs don't depend on each other and are fitted
+// concurrently by njobs workers.
+// Parameters the pdf doesn't depend on are not fixed, and are ignored
+// when comparing jobs: jobs with the same histogram and the same fixed
+// parameters are fitted once.
+std::vector<fit_job_result> run_fit_plan(
+  workspace& ws, const std::vector<fit_job>& jobs, unsigned njobs);
+
+#endif
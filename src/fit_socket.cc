@@ -0,0 +1,336 @@
+#include "fit_socket.hh"
+
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <TH1.h>
+#include <TGraph.h>
+#include <TMatrixDSym.h>
+
+#include <RooRealVar.h>
+#include <RooArgList.h>
+#include <RooFitResult.h>
+
+#include "catstr.hh"
+#include "text_num.hh"
+
+using namespace std;
+
+namespace {
+
+[[noreturn]] void sys_fail(const char* what) {
+  throw runtime_error(cat("fit socket: ",what,": ",strerror(errno)));
+}
+
+// RooFitResult setters are protected, they are meant for minimizers
+class remote_fit_result: public RooFitResult {
+public:
+  remote_fit_result(): RooFitResult("remote_fit","remote fit") { }
+  using RooFitResult::setConstParList;
+  using RooFitResult::setInitParList;
+  using RooFitResult::setFinalParList;
+  using RooFitResult::setCovarianceMatrix;
+  using RooFitResult::setStatus;
+  using RooFitResult::setCovQual;
+  using RooFitResult::setMinNLL;
+  using RooFitResult::setEDM;
+  using RooFitResult::setNumInvalidNLL;
+};
+
+void write_vec(ostream& out, const char* name, const vector<double>& v) {
+  out << name << ' ' << v.size();
+  for (double x : v) out << ' ' << put_num(x);
+  out << '\n';
+}
+
+void read_vec(istream& in, const char* name, vector<double>& v) {
+  string key;
+  size_t n;
+  if (!(in >> key >> n) || key!=name)
+    throw runtime_error(cat("fit socket: expected ",name));
+  v.resize(n);
+  for (double& x : v) in >> get_num(x);
+}
+
+}
+
+void fit_request::set_hist(const TH1* hist) {
+  const int n = hist->GetNbinsX();
+  edges.resize(n+1);
+  contents.resize(n);
+  errors.resize(n);
+  for (int i=0; i<n; ++i) {
+    edges[i] = hist->GetBinLowEdge(i+1);
+    contents[i] = hist->GetBinContent(i+1);
+    errors[i] = hist->GetBinError(i+1);
+  }
+  edges[n] = hist->GetXaxis()->GetBinUpEdge(n);
+  uniform = !hist->GetXaxis()->IsVariableBinSize();
+  entries = hist->GetEntries();
+}
+
+TH1* fit_request::hist() const {
+  const int n = edges.size()-1;
+  TH1 *h = uniform
+    ? new TH1D("remote_hist","",n,edges.front(),edges.back())
+    : new TH1D("remote_hist","",n,edges.data());
+  h->SetDirectory(0);
+  h->Sumw2();
+  for (size_t i=0; i<contents.size(); ++i) {
+    h->SetBinContent(i+1,contents[i]);
+    h->SetBinError(i+1,errors[i]);
+  }
+  h->SetEntries(entries);
+  return h;
+}
+
+string fit_request::str() const {
+  stringstream ss;
+  ss << setprecision(17)
+     << "fit\n"
+     << "workspace " << workspace << '\n'
+     << "bg " << bg << '\n'
+     << "curve " << curve << '\n'
+     << "uniform " << uniform << '\n'
+     << "entries " << put_num(entries) << '\n';
+  write_vec(ss,"edges",edges);
+  write_vec(ss,"contents",contents);
+  write_vec(ss,"errors",errors);
+  ss << "vars " << vars.size() << '\n';
+  for (const auto& v : vars)
+    ss << v.name << ' ' << put_num(v.val) << ' ' << put_num(v.err) << ' '
+       << put_num(v.min) << ' ' << put_num(v.max) << ' '
+       << v.constant << '\n';
+  return ss.str();
+}
+
+fit_request fit_request::parse(const string& str) {
+  stringstream ss(str);
+  fit_request req;
+  string key;
+  size_t n;
+  ss >> key;
+  if (key!="fit") throw runtime_error("fit socket: not a fit request");
+  ss >> key;
+  ss.ignore();
+  getline(ss,req.workspace); // the path may contain spaces
+  ss >> key >> req.bg
+     >> key >> req.curve
+     >> key >> req.uniform
+     >> key >> get_num(req.entries);
+  read_vec(ss,"edges",req.edges);
+  read_vec(ss,"contents",req.contents);
+  read_vec(ss,"errors",req.errors);
+  ss >> key >> n;
+  req.vars.resize(n);
+  for (auto& v : req.vars)
+    ss >> v.name >> get_num(v.val) >> get_num(v.err)
+       >> get_num(v.min) >> get_num(v.max) >> v.constant;
+  if (!ss) throw runtime_error("fit socket: bad fit request");
+  if (req.edges.size()<2 || req.contents.size()+1!=req.edges.size())
+    throw runtime_error("fit socket: bad histogram in fit request");
+  return req;
+}
+
+string fit_server_socket() {
+  if (const char *env = getenv("PESFIT_FIT_SERVER")) return env;
+  return cat("/tmp/pesfit_fitd_",getuid(),".sock");
+}
+
+string fit_reply(const RooFitResult& res, const TGraph* curve) {
+  stringstream ss;
+  ss << setprecision(17)
+     << "ok\n"
+     << res.status() << ' ' << res.covQual() << ' ' << put_num(res.edm())
+     << ' ' << put_num(res.minNll()) << ' ' << res.numInvalidNLL() << '\n';
+
+  const RooArgList& pars = res.floatParsFinal();
+  ss << "float " << pars.getSize() << '\n';
+  for (int i=0; i<pars.getSize(); ++i) {
+    const auto *v = static_cast<const RooRealVar*>(pars.at(i));
+    ss << v->GetName() << ' ' << put_num(v->getVal())
+       << ' ' << put_num(v->getError()) << '\n';
+  }
+  const RooArgList& consts = res.constPars();
+  ss << "const " << consts.getSize() << '\n';
+  for (int i=0; i<consts.getSize(); ++i) {
+    const auto *v = static_cast<const RooRealVar*>(consts.at(i));
+    ss << v->GetName() << ' ' << put_num(v->getVal()) << '\n';
+  }
+
+  const TMatrixDSym& cov = res.covarianceMatrix();
+  const int n = cov.GetNrows();
+  ss << "cov " << n*n;
+  for (int i=0; i<n; ++i)
+    for (int j=0; j<n; ++j) ss << ' ' << put_num(cov(i,j));
+  ss << '\n';
+
+  const int np = curve ? curve->GetN() : 0;
+  ss << "curve " << np;
+  for (int i=0; i<np; ++i)
+    ss << ' ' << put_num(curve->GetX()[i])
+       << ' ' << put_num(curve->GetY()[i]);
+  ss << '\n';
+  return ss.str();
+}
+
+pair<unique_ptr<RooFitResult>,TGraph*>
+remote_fit(const string& socket, const fit_request& req) {
+  const int fd = connect_socket(socket);
+  string reply;
+  try {
+    send_message(fd,req.str());
+    reply = recv_message(fd);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+
+  stringstream ss(reply);
+  string key;
+  ss >> key;
+  if (key!="ok") {
+    string msg;
+    getline(ss,msg);
+    throw runtime_error("fit server:"+msg);
+  }
+
+  int status, cov_qual, ninvalid;
+  double edm, min_nll;
+  ss >> status >> cov_qual >> get_num(edm) >> get_num(min_nll) >> ninvalid;
+
+  // the result keeps copies of the variables
+  vector<unique_ptr<RooRealVar>> vars;
+  RooArgList floats, consts;
+  size_t n;
+  ss >> key >> n;
+  for (size_t i=0; i<n; ++i) {
+    string name;
+    double val, err;
+    ss >> name >> get_num(val) >> get_num(err);
+    vars.emplace_back(new RooRealVar(name.c_str(),name.c_str(),val));
+    vars.back()->setError(err);
+    floats.add(*vars.back());
+  }
+  ss >> key >> n;
+  for (size_t i=0; i<n; ++i) {
+    string name;
+    double val;
+    ss >> name >> get_num(val);
+    vars.emplace_back(new RooRealVar(name.c_str(),name.c_str(),val));
+    consts.add(*vars.back());
+  }
+
+  vector<double> cov_flat;
+  read_vec(ss,"cov",cov_flat);
+  const int nc = floats.getSize();
+  if (cov_flat.size()!=size_t(nc*nc))
+    throw runtime_error("fit server: bad covariance matrix");
+  TMatrixDSym cov(nc);
+  for (int i=0; i<nc; ++i)
+    for (int j=0; j<nc; ++j) cov(i,j) = cov_flat[i*nc+j];
+
+  vector<double> points;
+  read_vec(ss,"curve",points);
+  if (!ss) throw runtime_error("fit server: bad reply");
+
+  auto *res = new remote_fit_result();
+  res->setConstParList(consts);
+  res->setInitParList(floats);
+  res->setFinalParList(floats);
+  res->setCovarianceMatrix(cov);
+  res->setStatus(status);
+  res->setCovQual(cov_qual);
+  res->setMinNLL(min_nll);
+  res->setEDM(edm);
+  res->setNumInvalidNLL(ninvalid);
+
+  TGraph *curve = nullptr;
+  if (req.curve) {
+    curve = new TGraph(points.size()/2);
+    for (size_t i=0; i<points.size()/2; ++i)
+      curve->SetPoint(i,points[2*i],points[2*i+1]);
+  }
+
+  return {unique_ptr<RooFitResult>(res),curve};
+}
+
+void send_message(int fd, const string& msg) {
+  const uint64_t size = msg.size();
+  string buf(reinterpret_cast<const char*>(&size),sizeof(size));
+  buf += msg;
+  for (const char *p = buf.data(), *end = p+buf.size(); p<end; ) {
+    const ssize_t w = ::write(fd,p,end-p);
+    if (w < 0) {
+      if (errno==EINTR) continue;
+      sys_fail("write");
+    }
+    p += w;
+  }
+}
+
+string recv_message(int fd) {
+  auto read_all = [fd](char* p, size_t n){
+    while (n) {
+      const ssize_t r = ::read(fd,p,n);
+      if (r < 0) {
+        if (errno==EINTR) continue;
+        sys_fail("read");
+      }
+      if (r==0) throw runtime_error("fit socket: connection closed");
+      p += r;
+      n -= r;
+    }
+  };
+  uint64_t size;
+  read_all(reinterpret_cast<char*>(&size),sizeof(size));
+  string msg(size,'\0');
+  read_all(&msg[0],size);
+  return msg;
+}
+
+namespace {
+sockaddr_un socket_addr(const string& path) {
+  sockaddr_un addr;
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path))
+    throw runtime_error("fit socket: path too long: "+path);
+  strcpy(addr.sun_path,path.c_str());
+  return addr;
+}
+}
+
+int listen_socket(const string& path) {
+  const sockaddr_un addr = socket_addr(path);
+  const int fd = ::socket(AF_UNIX,SOCK_STREAM,0);
+  if (fd < 0) sys_fail("socket");
+  ::unlink(path.c_str());
+  if (::bind(fd,reinterpret_cast<const sockaddr*>(&addr),sizeof(addr)))
+    sys_fail("bind");
+  if (::listen(fd,64)) sys_fail("listen");
+  return fd;
+}
+
+int connect_socket(const string& path) {
+  const sockaddr_un addr = socket_addr(path);
+  const int fd = ::socket(AF_UNIX,SOCK_STREAM,0);
+  if (fd < 0) sys_fail("socket");
+  if (::connect(fd,reinterpret_cast<const sockaddr*>(&addr),sizeof(addr))) {
+    const int err = errno;
+    ::close(fd);
+    throw fit_server_unavailable(cat(
+      "fit socket: connect ",path,": ",strerror(err)));
+  }
+  return fd;
+}
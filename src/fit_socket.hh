@@ -0,0 +1,66 @@
+#ifndef fit_socket_hh
+#define fit_socket_hh
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+
+class TH1;
+class TGraph;
+class RooFitResult;
+
+// Fits requested from a resident fit server (fitd) over a Unix domain
+// socket, so that ROOT startup and workspace loading are paid once.
+// Messages are length-prefixed text.
+
+// State of a workspace variable, set before the fit
+struct fit_var {
+  std::string name;
+  double val, err, min, max;
+  bool constant;
+};
+
+struct fit_request {
+  std::string workspace; // absolute path of the ROOT file
+  bool bg = false;       // datafit instead of mcfit
+  bool curve = true;     // return the fitted curve points
+  std::vector<double> edges, contents, errors; // histogram bins
+  bool uniform = true;   // the axis has fixed width bins
+  double entries = 0;
+  std::vector<fit_var> vars;
+
+  void set_hist(const TH1* hist);
+  // Rebuilt with the axis kind of the sent histogram, uniform or
+  // variable width bins, which workspace::fit imports differently.
+  // Not owned by any directory.
+  TH1* hist() const;
+
+  std::string str() const;
+  static fit_request parse(const std::string& str);
+};
+
+// Default socket of the fit server, PESFIT_FIT_SERVER if set
+std::string fit_server_socket();
+
+// Thrown by connect_socket when no server accepts the connection
+struct fit_server_unavailable: std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Send a fit request to the server listening on socket and
+// return the fit result and, if requested, the curve
+std::pair<std::unique_ptr<RooFitResult>,TGraph*>
+remote_fit(const std::string& socket, const fit_request& req);
+
+// Reply for a successful fit
+std::string fit_reply(const RooFitResult& res, const TGraph* curve);
+
+// Length-prefixed messages and sockets
+void send_message(int fd, const std::string& msg);
+std::string recv_message(int fd);
+int listen_socket(const std::string& path);
+int connect_socket(const std::string& path);
+
+#endif
@@ -0,0 +1,184 @@
+// Resident fit server: keeps workspaces loaded and fits histograms
+// sent over a Unix domain socket.
+// Every request is fitted in a forked child of the server, so fits
+// start from the workspace as loaded and don't affect each other.
+// Tools use the server when PESFIT_FIT_SERVER is set to its socket.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <boost/program_options.hpp>
+
+#include <TH1.h>
+#include <TGraph.h>
+#include <TROOT.h>
+
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooFitResult.h>
+#include <RooMsgService.h>
+
+#include "workspace.hh"
+#include "fit_socket.hh"
+
+using namespace std;
+namespace po = boost::program_options;
+
+#define test(var) \
+  std::cout <<"\033[36m"<< #var <<"\033[0m"<< " = " << var << std::endl;
+
+string socket_path;
+
+extern "C" void stop(int) {
+  ::unlink(socket_path.c_str());
+  _exit(0);
+}
+
+int main(int argc, char** argv)
+{
+  vector<string> wfnames;
+  unsigned njobs;
+
+  // options ---------------------------------------------------
+  try {
+    po::options_description desc("Options");
+    desc.add_options()
+      ("socket,S", po::value(&socket_path)->default_value(fit_server_socket()),
+       "Unix domain socket to listen on")
+      ("workspace,w", po::value(&wfnames)->multitoken(),
+       "ROOT files with RooWorkspace to load at startup,\n"
+       "others are loaded on first request")
+      ("jobs,j", po::value(&njobs)->default_value(4),
+       "maximum number of concurrent fits")
+      ("help,h", "produce help message")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return 0;
+    }
+    po::notify(vm);
+    if (njobs < 1) njobs = 1;
+  } catch (std::exception& e) {
+    cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
+    return 1;
+  }
+  // end options ---------------------------------------------------
+
+  // fits are done here, not sent to another server
+  unsetenv("PESFIT_FIT_SERVER");
+
+  gROOT->SetBatch(true);
+  RooMsgService::instance().setGlobalKillBelow(RooFit::ERROR);
+
+  // workspaces by absolute file name and mcfit or datafit
+  map<pair<string,bool>,unique_ptr<workspace>> wss;
+  auto get_ws = [&wss](const string& fname, bool bg) -> workspace& {
+    auto& ws = wss[{fname,bg}];
+    if (!ws) {
+      cout << "Loading " << (bg ? "datafit" : "mcfit")
+           << " from " << fname << endl;
+      ws.reset(new workspace(fname,bg));
+    }
+    return *ws;
+  };
+  for (const auto& f : wfnames) {
+    char *path = realpath(f.c_str(),nullptr);
+    if (!path) {
+      cerr << "\033[31m" << f << ": " << strerror(errno) << "\033[0m" << endl;
+      return 1;
+    }
+    get_ws(path,false);
+    free(path);
+  }
+
+  const int lfd = listen_socket(socket_path);
+  signal(SIGINT,stop);
+  signal(SIGTERM,stop);
+  signal(SIGPIPE,SIG_IGN);
+  cout << "Listening on " << socket_path << endl;
+
+  unsigned active = 0;
+  for (;;) {
+    const int fd = ::accept(lfd,nullptr,nullptr);
+    if (fd < 0) {
+      if (errno==EINTR) continue;
+      cerr << "\033[31maccept: " << strerror(errno) << "\033[0m" << endl;
+      break;
+    }
+
+    // the workspace is loaded in the server, before forking,
+    // so that later requests find it loaded
+    fit_request req;
+    workspace *ws;
+    try {
+      req = fit_request::parse(recv_message(fd));
+      ws = &get_ws(req.workspace,req.bg);
+    } catch (const std::exception& e) {
+      cerr << "\033[31m" << e.what() << "\033[0m" << endl;
+      try { send_message(fd,string("error ")+e.what()); } catch (...) { }
+      ::close(fd);
+      continue;
+    }
+
+    for (; active && ::waitpid(-1,nullptr,WNOHANG) > 0; --active) ;
+    for (; active >= njobs && ::waitpid(-1,nullptr,0) > 0; --active) ;
+
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+      cerr << "\033[31mfork: " << strerror(errno) << "\033[0m" << endl;
+      ::close(fd);
+      continue;
+    }
+    if (pid==0) { // fit in the child
+      ::close(lfd);
+      signal(SIGINT,SIG_DFL);
+      signal(SIGTERM,SIG_DFL);
+      int status = 0;
+      try {
+        for (const auto& v : req.vars) {
+          auto *var = (*ws)->var(v.name.c_str());
+          if (!var) continue;
+          var->setRange(v.min,v.max);
+          var->setVal(v.val);
+          var->setError(v.err);
+          var->setConstant(v.constant);
+        }
+        unique_ptr<TH1> hist(req.hist());
+
+        fit_options opt;
+        opt.curve = req.curve;
+        opt.verbose = false;
+        opt.ncpu = 1;
+        const auto fit = ws->fit(hist.get(),opt);
+        send_message(fd,fit_reply(*fit.first,fit.second));
+      } catch (const std::exception& e) {
+        cerr << "\033[31m" << e.what() << "\033[0m" << endl;
+        try { send_message(fd,string("error ")+e.what()); } catch (...) { }
+        status = 1;
+      }
+      ::close(fd);
+      cout.flush();
+      cerr.flush();
+      _exit(status);
+    }
+    ::close(fd);
+    ++active;
+  }
+
+  ::unlink(socket_path.c_str());
+  return 1;
+}
@@ -0,0 +1,154 @@
+#include "fork_pool.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <cstdio>
+#include <cerrno>
+#include <cstdint>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+namespace {
+
+void write_all(int fd, const char* data, size_t n) {
+  while (n) {
+    const ssize_t w = ::write(fd,data,n);
+    if (w < 0) {
+      if (errno==EINTR) continue;
+      std::cerr << "\033[31mfork_map: write failed: "
+                << std::strerror(errno) << "\033[0m" << std::endl;
+      _exit(2);
+    }
+    data += w;
+    n -= w;
+  }
+}
+
+struct worker {
+  pid_t pid;
+  int fd;
+  std::string buf;
+};
+
+}
+
+std::vector<std::string> fork_map(
+  size_t njobs, unsigned nworkers,
+  const std::function<std::string(size_t)>& job
+) {
+  std::vector<std::string> results(njobs);
+
+  if (nworkers > njobs) nworkers = njobs;
+  if (nworkers < 2) {
+    for (size_t i=0; i<njobs; ++i) results[i] = job(i);
+    return results;
+  }
+
+  // don't let the children inherit unflushed output
+  std::cout.flush();
+  std::cerr.flush();
+  std::fflush(nullptr);
+
+  std::vector<worker> workers;
+  workers.reserve(nworkers);
+
+  for (unsigned w=0; w<nworkers; ++w) {
+    int fds[2];
+    if (::pipe(fds)) throw std::runtime_error(
+      std::string("fork_map: pipe: ")+std::strerror(errno));
+
+    const pid_t pid = ::fork();
+    if (pid < 0) throw std::runtime_error(
+      std::string("fork_map: fork: ")+std::strerror(errno));
+
+    if (pid==0) { // worker process
+      ::close(fds[0]);
+      for (const auto& other : workers) ::close(other.fd);
+
+      auto send = [&](uint64_t i, const std::string& res){
+        const uint64_t head[2] = { i, res.size() };
+        write_all(fds[1],reinterpret_cast<const char*>(head),sizeof(head));
+        write_all(fds[1],res.data(),res.size());
+      };
+
+      int status = 0;
+      run_report::reset();
+      try {
+        for (size_t i=w; i<njobs; i+=nworkers) send(i,job(i));
+        // index njobs carries the worker's stage counters
+        send(njobs,run_report::serialize());
+      } catch (const std::exception& e) {
+        std::cerr << "\033[31mWorker " << w << ": "
+                  << e.what() << "\033[0m" << std::endl;
+        status = 1;
+      }
+      ::close(fds[1]);
+      std::cout.flush();
+      std::cerr.flush();
+      std::fflush(nullptr);
+      // skip atexit handlers, the parent owns all open files
+      _exit(status);
+    }
+
+    ::close(fds[1]);
+    workers.push_back({pid,fds[0],{}});
+  }
+
+  // Drain all pipes concurrently, so that no worker blocks on a full pipe
+  std::vector<pollfd> pfds(nworkers);
+  for (unsigned w=0; w<nworkers; ++w)
+    pfds[w] = { workers[w].fd, POLLIN, 0 };
+
+  char chunk[1<<16];
+  for (unsigned open=nworkers; open; ) {
+    if (::poll(pfds.data(),nworkers,-1) < 0) {
+      if (errno==EINTR) continue;
+      throw std::runtime_error(
+        std::string("fork_map: poll: ")+std::strerror(errno));
+    }
+    for (unsigned w=0; w<nworkers; ++w) {
+      if (pfds[w].fd < 0 || !pfds[w].revents) continue;
+      const ssize_t n = ::read(pfds[w].fd,chunk,sizeof(chunk));
+      if (n > 0) workers[w].buf.append(chunk,n);
+      else if (n==0 || errno!=EINTR) {
+        ::close(pfds[w].fd);
+        pfds[w].fd = -1;
+        --open;
+      }
+    }
+  }
+
+  std::string err;
+  size_t nreceived = 0;
+  for (unsigned w=0; w<nworkers; ++w) {
+    int status;
+    ::waitpid(workers[w].pid,&status,0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+      err += " worker "+std::to_string(w)+" failed;";
+
+    const std::string& buf = workers[w].buf;
+    for (size_t pos=0; pos+2*sizeof(uint64_t) <= buf.size(); ) {
+      uint64_t head[2];
+      std::memcpy(head,buf.data()+pos,sizeof(head));
+      pos += sizeof(head);
+      if (head[0] > njobs || pos+head[1] > buf.size()) {
+        err += " worker "+std::to_string(w)+" sent a truncated result;";
+        break;
+      }
+      if (head[0]==njobs) {
+        run_report::merge(buf.substr(pos,head[1]));
+      } else {
+        results[head[0]].assign(buf,pos,head[1]);
+        ++nreceived;
+      }
+      pos += head[1];
+    }
+  }
+  if (nreceived!=njobs)
+    err += " "+std::to_string(njobs-nreceived)+" jobs did not return;";
+  if (!err.empty()) throw std::runtime_error("fork_map:"+err);
+
+  return results;
+}
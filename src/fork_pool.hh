@@ -0,0 +1,36 @@
+#ifndef fork_pool_hh
+#define fork_pool_hh
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstring>
+
+#include "run_report.hh"
+
+// ROOT and RooFit are not thread-safe, so jobs are run in forked
+// worker processes, each with its own copy-on-write image of the parent,
+// including any loaded workspace.
+// Job i runs in worker i % nworkers, so a job's environment does not
+// depend on scheduling. The bytes returned by every job are sent back
+// through a pipe and returned in job order.
+// Stages timed in a worker are added to the parent's run report.
+// With nworkers < 2 the jobs are run in the calling process.
+std::vector<std::string> fork_map(
+  size_t njobs, unsigned nworkers,
+  const std::function<std::string(size_t)>& job
+);
+
+// Byte packing of trivially copyable results
+template<typename T>
+inline std::string to_bytes(const T& x) {
+  return std::string(reinterpret_cast<const char*>(&x),sizeof(T));
+}
+template<typename T>
+inline T from_bytes(const std::string& bytes) {
+  T x;
+  std::memcpy(&x,bytes.data(),sizeof(T));
+  return x;
+}
+
+#endif
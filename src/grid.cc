@@ -0,0 +1,130 @@
+#include "grid.hh"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <cctype>
+
+#include <TTree.h>
+#include <TTreeFormula.h>
+#include <TLeaf.h>
+#include <TBranch.h>
+
+#include "catstr.hh"
+
+using namespace std;
+
+grid_axis grid_axis::parse(const string& str) {
+  grid_axis axis;
+  // a name is an identifier before '=', expressions may contain '=' too
+  size_t eq = str.find('=');
+  if (eq!=string::npos && (eq==0 || !all_of(str.begin(),str.begin()+eq,
+      [](char c){ return isalnum(c) || c=='_'; })))
+    eq = string::npos;
+  size_t end = str.size();
+  string fields[3];
+  for (int i=2; i>=0; --i) {
+    const size_t sep = str.rfind(':',end-1);
+    if (sep==string::npos || sep==0 || (eq!=string::npos && sep<eq))
+      throw invalid_argument(cat('\"',str,
+        "\": grid axis must be [name=]expr:nbins:min:max"));
+    fields[i] = str.substr(sep+1,end-sep-1);
+    end = sep;
+  }
+  axis.expr = str.substr(eq==string::npos ? 0 : eq+1,
+                         end-(eq==string::npos ? 0 : eq+1));
+  axis.name = eq==string::npos ? axis.expr : str.substr(0,eq);
+  axis.title = axis.expr;
+
+  int n;
+  double min, max;
+  if (!(stringstream(fields[0]) >> n) || !(stringstream(fields[1]) >> min)
+   || !(stringstream(fields[2]) >> max) || n<1 || !(min<max))
+    throw invalid_argument(cat('\"',str,"\": bad grid axis binning"));
+  for (int i=0; i<=n; ++i) axis.edges.push_back(min + i*(max-min)/n);
+  return axis;
+}
+
+int grid_axis::find(double x) const {
+  return upper_bound(edges.begin(),edges.end(),x) - edges.begin();
+}
+
+string grid_axis::label(int bin) const {
+  if (bin==0) return cat(name,'<',edges.front());
+  if (bin>nbins()) return cat(name,'>',edges.back());
+  return cat(name,'[',edges[bin-1],',',edges[bin],')');
+}
+
+grid::grid(vector<grid_axis> axes): axes_(move(axes)), strides(axes_.size()) {
+  if (axes_.empty()) throw invalid_argument("grid without axes");
+  size_t stride = 1;
+  for (size_t a=axes_.size(); a--; ) {
+    strides[a] = stride;
+    stride *= axes_[a].nbins()+2;
+  }
+}
+
+size_t grid::cell(const vector<int>& bins) const {
+  size_t c = 0;
+  for (size_t a=0; a<axes_.size(); ++a) c += bins[a]*strides[a];
+  return c;
+}
+
+vector<int> grid::bins(size_t cell) const {
+  vector<int> bins(axes_.size());
+  for (size_t a=0; a<axes_.size(); ++a) {
+    bins[a] = cell / strides[a];
+    cell %= strides[a];
+  }
+  return bins;
+}
+
+bool grid::inner(size_t cell) const {
+  const auto b = bins(cell);
+  for (size_t a=0; a<axes_.size(); ++a)
+    if (b[a]==0 || b[a]>axes_[a].nbins()) return false;
+  return true;
+}
+
+bool grid::underflow(size_t cell) const {
+  const auto b = bins(cell);
+  return find(b.begin(),b.end(),0) != b.end();
+}
+
+string grid::label(size_t cell) const {
+  const auto b = bins(cell);
+  string lbl;
+  for (size_t a=0; a<axes_.size(); ++a)
+    lbl += (a ? "_" : "") + axes_[a].label(b[a]);
+  return lbl;
+}
+
+grid_reader::grid_reader(const grid& g, TTree* tree)
+: g(g), bins(g.axes().size())
+{
+  for (const auto& axis : g.axes()) {
+    formulas.emplace_back(new TTreeFormula(axis.name.c_str(),
+      axis.expr.c_str(),tree));
+    if (!formulas.back()->GetNdim()) throw runtime_error(
+      "Bad grid axis expression "+axis.expr);
+  }
+}
+
+grid_reader::~grid_reader() { }
+
+vector<string> grid_reader::branches() const {
+  vector<string> names;
+  for (const auto& f : formulas)
+    for (int i=0, n=f->GetNcodes(); i<n; ++i)
+      if (TLeaf *leaf = f->GetLeaf(i))
+        names.emplace_back(leaf->GetBranch()->GetName());
+  return names;
+}
+
+size_t grid_reader::cell() {
+  for (size_t a=0; a<formulas.size(); ++a) {
+    formulas[a]->GetNdata(); // loads array branches
+    bins[a] = g.axes()[a].find(formulas[a]->EvalInstance(0));
+  }
+  return g.cell(bins);
+}
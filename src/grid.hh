@@ -0,0 +1,64 @@
+#ifndef grid_hh
+#define grid_hh
+
+#include <string>
+#include <vector>
+#include <memory>
+
+class TTree;
+class TTreeFormula;
+
+// Binning of events in one quantity, given by any TTree formula
+// expression, e.g. HGamEventInfoAuxDyn.pT_yy or HGamPhotonsAuxDyn.eta[0].
+// Bins are [a,b), bin 0 is the underflow and bin nbins()+1 the overflow.
+struct grid_axis {
+  std::string name, expr, title; // title labels plot axes
+  std::vector<double> edges;
+
+  // [name=]expr:nbins:min:max, name and title default to expr
+  static grid_axis parse(const std::string& str);
+
+  int nbins() const noexcept { return edges.size()-1; }
+  int find(double x) const;
+  std::string label(int bin) const; // name<a, name[a,b) or name>b
+};
+
+// N-dimensional grid of cells, a cell per combination of the bins of all
+// axes, including underflow and overflow bins.
+// Cells are numbered with the last axis varying fastest.
+class grid {
+  std::vector<grid_axis> axes_;
+  std::vector<size_t> strides;
+
+public:
+  explicit grid(std::vector<grid_axis> axes);
+
+  const std::vector<grid_axis>& axes() const noexcept { return axes_; }
+  size_t size() const noexcept { return strides.front()*(axes_.front().nbins()+2); }
+
+  size_t cell(const std::vector<int>& bins) const;
+  std::vector<int> bins(size_t cell) const;
+
+  bool inner(size_t cell) const; // no underflow or overflow bins
+  bool underflow(size_t cell) const; // underflow in some axis
+  std::string label(size_t cell) const; // axis labels joined by '_'
+};
+
+// Finds the cell of the current entry of a tree
+class grid_reader {
+  const grid& g;
+  std::vector<std::unique_ptr<TTreeFormula>> formulas;
+  std::vector<int> bins;
+
+public:
+  grid_reader(const grid& g, TTree* tree);
+  ~grid_reader();
+
+  // branches read by the axes' expressions, to be enabled
+  std::vector<std::string> branches() const;
+
+  // cell of the entry last read with TTree::GetEntry
+  size_t cell();
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "hist_bank.hh"
+
+#include <cmath>
+
+#include <TH1.h>
+
+hist_bank::hist_bank(size_t ncells, int nbins, double xmin, double xmax)
+: nbins(nbins), xmin(xmin), xmax(xmax),
+  sumw(ncells*(nbins+2)), sumw2(ncells*(nbins+2)), entries(ncells)
+{ }
+
+TH1* hist_bank::hist(size_t cell, const char* name, const char* title) const {
+  TH1 *h = new TH1D(name,title,nbins,xmin,xmax);
+  h->SetDirectory(0);
+  h->Sumw2();
+  const size_t first = cell*(nbins+2);
+  for (int bin=0; bin<nbins+2; ++bin) {
+    h->SetBinContent(bin,sumw[first+bin]);
+    h->SetBinError(bin,std::sqrt(sumw2[first+bin]));
+  }
+  h->SetEntries(entries[cell]);
+  return h;
+}
@@ -0,0 +1,46 @@
+#ifndef hist_bank_hh
+#define hist_bank_hh
+
+#include <vector>
+#include <cstddef>
+
+class TH1;
+
+// Histograms of many cells with the same uniform binning,
+// stored as flat arrays of sums of weights and of squared weights,
+// [cell*(nbins+2) + bin], bin 0 and nbins+1 being under- and overflow.
+// The scale of the current input file is applied to the weights as they
+// are filled, so files are merged without a pass over the cells.
+// TH1 objects are made only for the cells that are fitted or drawn.
+class hist_bank {
+  int nbins;
+  double xmin, xmax;
+  double scale = 1.;
+  std::vector<double> sumw, sumw2, entries;
+
+public:
+  hist_bank(size_t ncells, int nbins, double xmin, double xmax);
+
+  size_t size() const noexcept { return entries.size(); }
+
+  // Scale of the weights of the events filled from now on
+  void set_scale(double s) noexcept { scale = s; }
+
+  // Same bin as TAxis::FindFixBin
+  inline void fill(size_t cell, double x, double w) noexcept {
+    int bin;
+    if (x < xmin) bin = 0;
+    else if (!(x < xmax)) bin = nbins+1;
+    else bin = 1 + int(nbins*(x-xmin)/(xmax-xmin));
+    const size_t i = cell*(nbins+2) + bin;
+    w *= scale;
+    sumw[i] += w;
+    sumw2[i] += w*w;
+    entries[cell] += 1;
+  }
+
+  // New TH1D of a cell, not owned by any directory
+  TH1* hist(size_t cell, const char* name, const char* title) const;
+};
+
+#endif
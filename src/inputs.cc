@@ -0,0 +1,37 @@
+#include "inputs.hh"
+
+#include <stdexcept>
+
+#include <TFile.h>
+#include <TH1.h>
+
+#include "regex.hh"
+#include "catstr.hh"
+#include "root_safe_get.hh"
+
+using namespace std;
+
+string file_base(const string& fname) {
+  return fname.substr(fname.rfind('/')+1);
+}
+
+string file_process(const string& fname) {
+  static const regex proc_re(".*[\\._]?(gg.|VBF|ttH|WH|ZH)[0-9]*[\\._]?.*",
+                             regex_icase);
+  smatch proc_match;
+  if (!regex_match(fname, proc_match, proc_re))
+    throw runtime_error(cat("Filename \"",fname,"\" does not specify process"));
+  return proc_match.str(1);
+}
+
+double cutflow_scale(TFile* file, const string& fname) {
+  const string base = file_base(fname);
+  return 1./get<TH1>(file,
+    ("CutFlow_"+base.substr(0,base.find('.'))+"_weighted").c_str()
+  )->GetBinContent(3);
+}
+
+void process_set::add(const string& fname, const string& proc) {
+  if (!procs.emplace(proc).second)
+    throw runtime_error(cat("File \"",fname,"\" repeats process ",proc));
+}
@@ -0,0 +1,30 @@
+#ifndef inputs_hh
+#define inputs_hh
+
+#include <string>
+#include <unordered_set>
+
+class TFile;
+
+// Handling of MxAOD input files shared by pesfit, sweep and bench
+
+// File name without directory
+std::string file_base(const std::string& fname);
+
+// Production process named in the file name, e.g. ggH
+std::string file_process(const std::string& fname);
+
+// Inverse sum of weights, from bin 3 of the
+// CutFlow_<sample>_weighted histogram, where sample is the
+// file name up to the first '.'
+double cutflow_scale(TFile* file, const std::string& fname);
+
+// Input processes, every process may be given only once
+class process_set {
+  std::unordered_set<std::string> procs;
+public:
+  // Throws if fname repeats a process
+  void add(const std::string& fname, const std::string& proc);
+};
+
+#endif
@@ -0,0 +1,155 @@
+// Write synthetic MxAOD-like files for benchmarks and tests:
+// a CollectionTree with the HGamEventInfo*AuxDyn branches read by pesfit
+// and a CutFlow_<sample>_weighted histogram, one file per process
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TRandom3.h>
+
+#include "catstr.hh"
+
+using namespace std;
+namespace po = boost::program_options;
+
+#define test(var) \
+  std::cout <<"\033[36m"<< #var <<"\033[0m"<< " = " << var << std::endl;
+
+// cross section * BR(H->yy) * filter efficiency [pb] at 13 TeV
+const map<string,double> xsec_br {
+  {"ggH", 0.1102}, {"VBF", 0.00858}, {"WH", 0.00309},
+  {"ZH", 0.00201}, {"ttH", 0.00115}
+};
+
+// systematic name, relative m_yy scale shift, relative resolution change
+struct syst {
+  string name;
+  double scale, res;
+};
+
+int main(int argc, char** argv)
+{
+  string dir, prefix;
+  vector<string> procs;
+  Long64_t nevents;
+  ULong64_t seed;
+  unsigned nextra;
+
+  // options ---------------------------------------------------
+  try {
+    po::options_description desc("Options");
+    desc.add_options()
+      ("help,h", "produce help message")
+      ("dir,d", po::value(&dir)->default_value("."),
+       "output directory")
+      ("procs,p", po::value(&procs)->multitoken()->
+        default_value({"ggH","VBF","WH","ZH","ttH"},"ggH VBF WH ZH ttH"),
+       "production processes, one file each")
+      ("events,n", po::value(&nevents)->default_value(100000),
+       "generated events per file")
+      ("seed", po::value(&seed)->default_value(1),
+       "random seed")
+      ("extra-syst", po::value(&nextra)->default_value(0),
+       "number of extra EXTRA_SYST_<i> m_yy scale variations")
+      ("prefix", po::value(&prefix)->default_value("PowhegPy8_"),
+       "sample name prefix")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      cout << desc << endl;
+      return 0;
+    }
+    po::notify(vm);
+
+    for (const auto& proc : procs)
+      if (!xsec_br.count(proc)) throw runtime_error(
+        "unknown process "+proc);
+  } catch (std::exception& e) {
+    cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
+    return 1;
+  }
+  // end options ---------------------------------------------------
+
+  vector<syst> systs {
+    {"EG_SCALE_ALL", 0.004, 0.}, {"EG_RESOLUTION_ALL", 0., 0.12}
+  };
+  for (unsigned i=0; i<nextra; ++i)
+    systs.push_back({cat("EXTRA_SYST_",i), 0.0005*(i+1), 0.01*(i+1)});
+
+  const double mH = 125e3, sigma = 1.6e3; // MeV
+
+  for (size_t p=0; p<procs.size(); ++p) {
+    const string& proc = procs[p];
+    const string sample = cat(prefix,proc,"125");
+    const string fname = cat(dir,'/',sample,".MxAOD.root");
+
+    TRandom3 rng(seed*1000+p+1);
+
+    TFile file(fname.c_str(),"recreate");
+    if (file.IsZombie()) return 1;
+    TTree *tree = new TTree("CollectionTree","CollectionTree");
+
+    Float_t m_yy, crossSectionBRfilterEff = xsec_br.at(proc), weight;
+    Char_t isPassed;
+    Int_t numberOfPrimaryVertices;
+    vector<Float_t> m_var(2*systs.size());
+
+    tree->Branch("HGamEventInfoAuxDyn.m_yy",&m_yy);
+    tree->Branch("HGamEventInfoAuxDyn.crossSectionBRfilterEff",
+                 &crossSectionBRfilterEff);
+    tree->Branch("HGamEventInfoAuxDyn.weight",&weight);
+    tree->Branch("HGamEventInfoAuxDyn.isPassed",&isPassed);
+    tree->Branch("HGamEventInfoAuxDyn.numberOfPrimaryVertices",
+                 &numberOfPrimaryVertices);
+    for (size_t s=0; s<systs.size(); ++s) {
+      for (int ud=0; ud<2; ++ud) {
+        tree->Branch(cat("HGamEventInfo_",systs[s].name,"__1",
+          ud ? "up" : "down","AuxDyn.m_yy").c_str(), &m_var[2*s+ud]);
+      }
+    }
+
+    double sumw = 0.;
+    for (Long64_t ent=0; ent<nevents; ++ent) {
+      // gaussian core with a low mass tail, like a Crystal Ball
+      double dm = rng.Gaus(0.,sigma);
+      if (rng.Uniform() < 0.1) dm -= rng.Exp(3e3);
+      m_yy = mH + dm;
+
+      weight = rng.Gaus(1.,0.1);
+      sumw += weight;
+      numberOfPrimaryVertices = rng.Poisson(15)+1;
+      isPassed = rng.Uniform() < 0.4;
+
+      for (size_t s=0; s<systs.size(); ++s) {
+        for (int ud=0; ud<2; ++ud) {
+          const double sign = ud ? 1. : -1.;
+          m_var[2*s+ud] = (mH + dm*(1.+sign*systs[s].res))
+                        * (1.+sign*systs[s].scale);
+        }
+      }
+
+      tree->Fill();
+    }
+
+    // pesfit normalizes to the sum of weights in bin 3
+    TH1D *cutflow = new TH1D(cat("CutFlow_",sample,"_weighted").c_str(),"",
+                             5,0,5);
+    for (int b=1; b<=3; ++b) cutflow->SetBinContent(b,sumw);
+
+    file.Write();
+    cout << fname << ": " << nevents << " events" << endl;
+  }
+
+  return 0;
+}
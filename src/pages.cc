@@ -0,0 +1,63 @@
+#include "pages.hh"
+
+#include <iostream>
+#include <cstdio>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include <TROOT.h>
+#include <TError.h>
+#include <TCanvas.h>
+
+#include "catstr.hh"
+
+using namespace std;
+
+void save_pages(const string& ofname, const vector<page_t>& pages,
+                unsigned njobs) {
+  timed_stage stage("pdf");
+  if (njobs < 2 || pages.size() < 2) {
+    TCanvas canv;
+    canv.SaveAs((ofname+'[').c_str());
+    for (const auto& page : pages) {
+      canv.Clear();
+      page(canv);
+      canv.SaveAs(ofname.c_str());
+    }
+    canv.SaveAs((ofname+']').c_str());
+    return;
+  }
+
+  // forked workers must not share a connection to the display
+  gROOT->SetBatch(true);
+
+  // temporary pages next to the output, so merging stays on one filesystem
+  vector<string> names;
+  names.reserve(pages.size());
+  for (size_t i=0; i<pages.size(); ++i)
+    names.emplace_back(cat(ofname,'.',getpid(),".page",i,".pdf"));
+
+  auto remove_all = [&names]{
+    for (const auto& name : names) std::remove(name.c_str());
+  };
+
+  try {
+    fork_map(pages.size(), njobs, [&](size_t i){
+      gErrorIgnoreLevel = kWarning; // one "file created" line per page
+      timed_stage stage("page");
+      TCanvas canv;
+      pages[i](canv);
+      canv.SaveAs(names[i].c_str());
+      return string();
+    });
+    timed_stage merging("merge");
+    pdf_merge(names,ofname);
+  } catch (...) {
+    remove_all();
+    throw;
+  }
+  remove_all();
+  cout << "Info in <save_pages>: pdf file " << ofname << " has been created"
+       << " with " << pages.size() << " pages" << endl;
+}
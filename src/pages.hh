@@ -0,0 +1,23 @@
+#ifndef pages_hh
+#define pages_hh
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "fork_pool.hh"
+#include "pdf_merge.hh"
+
+class TCanvas;
+
+// A page draws itself on a cleared canvas.
+// Pages must not depend on what previous pages did to the canvas.
+using page_t = std::function<void(TCanvas&)>;
+
+// Draw pages into a multi-page pdf.
+// With njobs > 1 the pages are drawn concurrently in forked workers,
+// each into a temporary single-page pdf, and merged in page order.
+void save_pages(const std::string& ofname, const std::vector<page_t>& pages,
+                unsigned njobs = 1);
+
+#endif
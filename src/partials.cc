@@ -0,0 +1,254 @@
+#include "partials.hh"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TNamed.h>
+
+#include "catstr.hh"
+#include "root_safe_get.hh"
+
+using namespace std;
+
+namespace {
+
+string binning_str(int nbins, pair<double,double> xrange) {
+  stringstream ss;
+  ss << setprecision(17) << nbins << ' ' << xrange.first << ' ' << xrange.second;
+  return ss.str();
+}
+
+}
+
+vector<chunk> fill_chunks(
+  TTree* tree, const vector<variation>& vars,
+  int nbins, pair<double,double> xrange,
+  const string& file, const string& proc, double scale,
+  long long first, long long last
+) {
+  const long long nent = tree->GetEntries();
+  if (last < 0 || last > nent) last = nent;
+  if (first % chunk_entries) throw runtime_error(cat(
+    "First entry ",first," is not a multiple of ",chunk_entries));
+
+  const size_t nvars = vars.size();
+  vector<Float_t> m_yy(nvars);
+  vector<bool> has(nvars);
+  Float_t crossSectionBRfilterEff, weight;
+  Char_t isPassed;
+
+  auto *branches = tree->GetListOfBranches();
+  tree->SetBranchStatus("*",0);
+  auto addr = [tree](const string& branch, void* x){
+    tree->SetBranchStatus(branch.c_str(),1);
+    tree->SetBranchAddress(branch.c_str(),x);
+  };
+  addr("HGamEventInfoAuxDyn.crossSectionBRfilterEff",&crossSectionBRfilterEff);
+  addr("HGamEventInfoAuxDyn.weight",&weight);
+  addr("HGamEventInfoAuxDyn.isPassed",&isPassed);
+
+  for (size_t i=0; i<nvars; ++i) {
+    const string& branch = vars[i].branch;
+    if (!branches->Contains(branch.c_str())) continue;
+    addr(branch,&m_yy[i]);
+    has[i] = true;
+  }
+
+  vector<chunk> chunks;
+  unsigned long long nbytes = 0;
+  for (long long begin=first; begin<last; begin+=chunk_entries) {
+    const long long end = min(begin+chunk_entries,last);
+    chunks.push_back({file,proc,begin,end,nent,scale,{}});
+    auto& hists = chunks.back().hists;
+    hists.resize(nvars);
+    for (size_t i=0; i<nvars; ++i) {
+      if (!has[i]) continue;
+      hists[i].reset(new TH1D(vars[i].name.c_str(),"",
+        nbins,xrange.first,xrange.second));
+      hists[i]->SetDirectory(0);
+      hists[i]->Sumw2();
+    }
+
+    // LOOP over tree entries
+    for (long long ent=begin; ent<end; ++ent) {
+      nbytes += tree->GetEntry(ent);
+      if (isPassed!=1) continue;
+      const Double_t w = crossSectionBRfilterEff*weight;
+      for (size_t i=0; i<nvars; ++i)
+        if (hists[i]) hists[i]->Fill(m_yy[i]/1000,w);
+    }
+  }
+  run_report::count_bytes(nbytes);
+  run_report::count_events(last-first);
+
+  return chunks;
+}
+
+vector<unique_ptr<TH1>> sum_chunks(const vector<chunk>& chunks) {
+  vector<unique_ptr<TH1>> sums;
+  if (chunks.empty()) return sums;
+  sums.resize(chunks.front().hists.size());
+  for (const chunk& c : chunks) {
+    for (size_t i=0; i<sums.size(); ++i) {
+      const TH1 *h = c.hists[i].get();
+      if (!h) continue;
+      if (!sums[i]) {
+        sums[i].reset(static_cast<TH1*>(h->Clone(cat("tmp_",h->GetName()).c_str())));
+        sums[i]->SetDirectory(0);
+      } else sums[i]->Add(h);
+    }
+  }
+  const double scale = chunks.front().scale;
+  for (auto& h : sums)
+    if (h) h->Scale(1000.*scale/h->GetBinWidth(1));
+  return sums;
+}
+
+void write_partial(const string& fname,
+  const vector<variation>& vars,
+  int nbins, pair<double,double> xrange,
+  const vector<chunk>& chunks
+) {
+  TFile f(fname.c_str(),"recreate");
+  if (f.IsZombie()) throw runtime_error("Cannot write "+fname);
+
+  TNamed("pesfit_partial",binning_str(nbins,xrange).c_str()).Write();
+
+  string name, group, branch;
+  TTree *vtree = new TTree("variations","variations");
+  vtree->Branch("name",&name);
+  vtree->Branch("group",&group);
+  vtree->Branch("branch",&branch);
+  for (const auto& v : vars) {
+    name = v.name;
+    group = v.group;
+    branch = v.branch;
+    vtree->Fill();
+  }
+
+  // chunk i histograms are in directory chunk_i
+  string file, proc;
+  Long64_t first, last, entries;
+  Double_t scale;
+  TTree *ctree = new TTree("chunks","chunks");
+  ctree->Branch("file",&file);
+  ctree->Branch("proc",&proc);
+  ctree->Branch("first",&first);
+  ctree->Branch("last",&last);
+  ctree->Branch("entries",&entries);
+  ctree->Branch("scale",&scale);
+  for (size_t i=0; i<chunks.size(); ++i) {
+    const chunk& c = chunks[i];
+    file = c.file;
+    proc = c.proc;
+    first = c.first;
+    last = c.last;
+    entries = c.entries;
+    scale = c.scale;
+    ctree->Fill();
+
+    TDirectory *dir = f.mkdir(cat("chunk_",i).c_str());
+    for (const auto& h : c.hists)
+      if (h) dir->WriteTObject(h.get());
+  }
+
+  f.Write();
+  f.Close();
+}
+
+bool is_partial(const string& fname) {
+  TFile f(fname.c_str(),"read");
+  return !f.IsZombie() && f.Get("pesfit_partial");
+}
+
+vector<chunk> read_partials(const vector<string>& fnames,
+  vector<variation>& vars,
+  int nbins, pair<double,double> xrange
+) {
+  const string binning = binning_str(nbins,xrange);
+  vector<chunk> chunks;
+  bool first_file = true;
+
+  for (const string& fname : fnames) {
+    TFile f(fname.c_str(),"read");
+    if (f.IsZombie()) throw runtime_error("Cannot read "+fname);
+    cout << "Partial file: " << fname << endl;
+
+    if (binning != get<TNamed>(&f,"pesfit_partial")->GetTitle())
+      throw runtime_error(cat(fname," was filled with different binning: ",
+        get<TNamed>(&f,"pesfit_partial")->GetTitle()));
+
+    vector<variation> fvars;
+    {
+      string *name = nullptr, *group = nullptr, *branch = nullptr;
+      TTree *vtree = get<TTree>(&f,"variations");
+      vtree->SetBranchAddress("name",&name);
+      vtree->SetBranchAddress("group",&group);
+      vtree->SetBranchAddress("branch",&branch);
+      for (Long64_t i=0, n=vtree->GetEntries(); i<n; ++i) {
+        vtree->GetEntry(i);
+        fvars.push_back({*name,*group,*branch});
+      }
+    }
+    if (first_file) {
+      vars = fvars;
+      first_file = false;
+    } else if (fvars.size()!=vars.size() || !equal(
+      vars.begin(),vars.end(),fvars.begin(),
+      [](const variation& a, const variation& b){
+        return a.name==b.name && a.branch==b.branch;
+      })
+    ) throw runtime_error(cat(fname," has different variations"));
+
+    string *file = nullptr, *proc = nullptr;
+    Long64_t first, last, entries;
+    Double_t scale;
+    TTree *ctree = get<TTree>(&f,"chunks");
+    ctree->SetBranchAddress("file",&file);
+    ctree->SetBranchAddress("proc",&proc);
+    ctree->SetBranchAddress("first",&first);
+    ctree->SetBranchAddress("last",&last);
+    ctree->SetBranchAddress("entries",&entries);
+    ctree->SetBranchAddress("scale",&scale);
+    for (Long64_t i=0, n=ctree->GetEntries(); i<n; ++i) {
+      ctree->GetEntry(i);
+      chunks.push_back({*file,*proc,first,last,entries,scale,{}});
+      auto& hists = chunks.back().hists;
+      hists.resize(vars.size());
+      TDirectory *dir = get<TDirectory>(&f,cat("chunk_",i).c_str());
+      for (size_t v=0; v<vars.size(); ++v) {
+        TH1 *h = static_cast<TH1*>(dir->Get(vars[v].name.c_str()));
+        if (!h) continue;
+        h->SetDirectory(0);
+        hists[v].reset(h);
+      }
+    }
+  }
+
+  // the order of a single pesfit run, which reads inputs by file name
+  stable_sort(chunks.begin(),chunks.end(),
+    [](const chunk& a, const chunk& b){
+      return a.file < b.file || (a.file==b.file && a.first < b.first);
+    });
+
+  for (size_t i=0; i<chunks.size(); ++i) {
+    const chunk& c = chunks[i];
+    const bool file_begin = (i==0 || chunks[i-1].file!=c.file);
+    const long long expected = file_begin ? 0 : chunks[i-1].last;
+    if (c.first != expected) throw runtime_error(cat(
+      c.file,": entries ",min(expected,c.first),'-',max(expected,c.first),
+      (c.first < expected ? " are in more than one partial"
+                          : " are in no partial")));
+    const bool file_end = (i+1==chunks.size() || chunks[i+1].file!=c.file);
+    if (file_end && c.last != c.entries) throw runtime_error(cat(
+      c.file,": entries ",c.last,'-',c.entries," are in no partial"));
+  }
+
+  return chunks;
+}
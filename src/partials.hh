@@ -0,0 +1,62 @@
+#ifndef partials_hh
+#define partials_hh
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+
+#include "variations.hh"
+#include "run_report.hh"
+
+class TTree;
+class TH1;
+
+// Histograms are filled in chunks of chunk_entries tree entries,
+// and the chunks of a file are summed in entry order.
+// Ingestion split into chunk aligned entry ranges, possibly on different
+// nodes, therefore sums exactly the same numbers in the same order
+// as a single process.
+constexpr long long chunk_entries = 1 << 20;
+
+// Unscaled m_yy histograms of one chunk of one input file
+struct chunk {
+  std::string file;  // input file name, without directory
+  std::string proc;  // process, e.g. ggH
+  long long first, last, entries; // entry range and entries in the tree
+  double scale;      // inverse sum of weights from the CutFlow histogram
+  std::vector<std::unique_ptr<TH1>> hists; // [variation], null if missing
+};
+
+// Fill chunks with the entries [first,last) of the tree,
+// last < 0 reads to the end. first must be chunk aligned.
+std::vector<chunk> fill_chunks(
+  TTree* tree, const std::vector<variation>& vars,
+  int nbins, std::pair<double,double> xrange,
+  const std::string& file, const std::string& proc, double scale,
+  long long first = 0, long long last = -1);
+
+// Sum the chunks of one file into d(sigma)/dm_yy histograms in fb/GeV,
+// [variation], null if missing, not owned by any directory
+std::vector<std::unique_ptr<TH1>> sum_chunks(const std::vector<chunk>& chunks);
+
+// Partial files -----------------------------------------------------
+// A partial file keeps the chunks written by a split pesfit run,
+// with the variations and histogram binning they were filled with.
+
+void write_partial(const std::string& fname,
+  const std::vector<variation>& vars,
+  int nbins, std::pair<double,double> xrange,
+  const std::vector<chunk>& chunks);
+
+bool is_partial(const std::string& fname);
+
+// Chunks of any number of partial files, sorted by file name
+// and first entry, checked to cover every file's entries exactly once.
+// vars is set from the partials, which must all agree with it
+// and with the binning.
+std::vector<chunk> read_partials(const std::vector<std::string>& fnames,
+  std::vector<variation>& vars,
+  int nbins, std::pair<double,double> xrange);
+
+#endif
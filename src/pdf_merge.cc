@@ -0,0 +1,250 @@
+#include "pdf_merge.hh"
+
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <cstring>
+#include <cctype>
+#include <cstdio>
+
+using namespace std;
+
+namespace {
+
+struct pdf_file {
+  string name, data;
+  map<long,pair<size_t,size_t>> objs; // number -> [begin,end) in data
+  long root = 0, info = 0, max_num = 0;
+
+  pdf_file(const string& name): name(name) {
+    ifstream f(name, ios::binary);
+    if (!f) throw runtime_error("pdf_merge: cannot open "+name);
+    stringstream ss;
+    ss << f.rdbuf();
+    data = ss.str();
+    read_xref();
+  }
+
+  [[noreturn]] void fail(const string& what) const {
+    throw runtime_error("pdf_merge: "+name+": "+what);
+  }
+
+  // Parse the classic cross-reference table and the trailer.
+  // Objects are delimited by the offset of the next object.
+  void read_xref() {
+    const size_t sx = data.rfind("startxref");
+    if (sx==string::npos) fail("no startxref");
+    const size_t xref = strtoul(data.c_str()+sx+9,nullptr,10);
+    if (data.compare(xref,4,"xref")) fail("no classic xref table");
+
+    istringstream in(data.substr(xref+4,sx-xref-4));
+    map<size_t,long> by_offset;
+    string tok;
+    while (in >> tok && tok!="trailer") {
+      long first = stol(tok), n;
+      in >> n;
+      for (long i=0; i<n; ++i) {
+        size_t offset;
+        int gen;
+        char type;
+        in >> offset >> gen >> type;
+        if (type=='n') by_offset[offset] = first+i;
+      }
+    }
+    if (tok!="trailer") fail("no trailer");
+    string trailer;
+    getline(in,trailer,'\0');
+    root = ref_after(trailer,"/Root");
+    info = ref_after(trailer,"/Info");
+    if (!root) fail("no /Root in trailer");
+
+    for (auto it=by_offset.begin(); it!=by_offset.end(); ++it) {
+      auto next = it; ++next;
+      const size_t end = (next==by_offset.end() ? xref : next->first);
+      objs[it->second] = { it->first, end };
+      if (it->second > max_num) max_num = it->second;
+    }
+  }
+
+  string obj(long num) const {
+    auto it = objs.find(num);
+    if (it==objs.end()) fail("missing object "+to_string(num));
+    return data.substr(it->second.first,it->second.second-it->second.first);
+  }
+
+  // Object number of the reference following key, 0 if none
+  static long ref_after(const string& s, const char* key) {
+    const size_t k = s.find(key);
+    if (k==string::npos) return 0;
+    return strtol(s.c_str()+k+strlen(key),nullptr,10);
+  }
+};
+
+inline bool is_delim(char c) {
+  return isspace((unsigned char)c) || strchr("()<>[]{}/%",c);
+}
+
+// Shift every indirect reference "n g R" and the "n g obj" header
+// by offset. Strings and stream data are copied as is.
+string renumber(const string& s, long offset) {
+  string out;
+  out.reserve(s.size()+16);
+  size_t i=0;
+  const size_t n=s.size();
+  while (i<n) {
+    const char c = s[i];
+    if (c=='(') { // literal string, may contain anything
+      int depth = 0;
+      const size_t start = i;
+      for (; i<n; ++i) {
+        if (s[i]=='\\') { ++i; continue; }
+        if (s[i]=='(') ++depth;
+        else if (s[i]==')' && --depth==0) { ++i; break; }
+      }
+      out.append(s,start,i-start);
+      continue;
+    }
+    if (c=='s' && !s.compare(i,6,"stream") && (i==0 || is_delim(s[i-1]))
+        && i+6<n && (s[i+6]=='\r' || s[i+6]=='\n')) {
+      // the rest of the object is the stream data and "endstream endobj"
+      out.append(s,i,string::npos);
+      break;
+    }
+    if (isdigit((unsigned char)c) && (i==0 || is_delim(s[i-1]))) {
+      size_t j=i;
+      while (j<n && isdigit((unsigned char)s[j])) ++j;
+      size_t k=j;
+      while (k<n && isspace((unsigned char)s[k])) ++k;
+      const size_t g=k;
+      while (k<n && isdigit((unsigned char)s[k])) ++k;
+      if (k>g && k<n && isspace((unsigned char)s[k])) {
+        while (k<n && isspace((unsigned char)s[k])) ++k;
+        size_t kw = 0;
+        if (k<n && s[k]=='R') kw = 1;
+        else if (!s.compare(k,3,"obj")) kw = 3;
+        if (kw && (k+kw==n || is_delim(s[k+kw]))) {
+          out += to_string(stol(s.substr(i,j-i))+offset);
+          out.append(s,j,k+kw-j);
+          i = k+kw;
+          continue;
+        }
+      }
+      out.append(s,i,j-i);
+      i = j;
+      continue;
+    }
+    out += c;
+    ++i;
+  }
+  return out;
+}
+
+// Object numbers listed in /Kids [ ... ]
+vector<long> kids(const string& pages) {
+  vector<long> v;
+  const size_t k = pages.find("/Kids");
+  if (k==string::npos) return v;
+  const size_t a = pages.find('[',k), b = pages.find(']',k);
+  if (a==string::npos || b==string::npos) return v;
+  istringstream in(pages.substr(a+1,b-a-1));
+  long num, gen;
+  string r;
+  while (in >> num >> gen >> r) v.push_back(num);
+  return v;
+}
+
+// Point the /Parent reference of a page to a new object
+string reparent(const string& page, long parent) {
+  const size_t k = page.find("/Parent");
+  if (k==string::npos) return page;
+  const size_t r = page.find('R',k);
+  return page.substr(0,k) + "/Parent " + to_string(parent) + " 0 "
+       + page.substr(r);
+}
+
+}
+
+void pdf_merge(const vector<string>& inputs, const string& output) {
+  vector<pair<long,size_t>> xref; // object number, offset in output
+  vector<long> all_pages;
+  long offset = 0, info = 0;
+
+  // Objects of file k are shifted by the number of objects before it.
+  // The catalog and page tree roots are replaced by new ones.
+  vector<pair<long,string>> objs;
+  for (const string& name : inputs) {
+    const pdf_file f(name);
+
+    const long pages_root = pdf_file::ref_after(f.obj(f.root),"/Pages");
+    if (!pages_root) f.fail("no /Pages in catalog");
+    const vector<long> pages = kids(f.obj(pages_root));
+    for (long p : pages) {
+      const string page = f.obj(p);
+      if (page.find("/Type /Pages")!=string::npos ||
+          page.find("/Type/Pages")!=string::npos)
+        f.fail("nested page trees are not supported");
+      all_pages.push_back(p+offset);
+    }
+
+    for (const auto& o : f.objs) {
+      if (o.first==f.root || o.first==pages_root) continue;
+      objs.emplace_back(o.first+offset,renumber(f.obj(o.first),offset));
+    }
+    if (!info && f.info) info = f.info+offset;
+    offset += f.max_num;
+  }
+
+  const long catalog = offset+1, pages_root = offset+2;
+
+  // page objects reference the new page tree root
+  const set<long> page_set(all_pages.begin(),all_pages.end());
+  for (auto& o : objs)
+    if (page_set.count(o.first)) o.second = reparent(o.second,pages_root);
+
+  ofstream out(output, ios::binary);
+  if (!out) throw runtime_error("pdf_merge: cannot write "+output);
+
+  const string header = "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+  size_t pos = header.size();
+  out << header;
+
+  auto write_obj = [&](long num, const string& s) {
+    xref.emplace_back(num,pos);
+    out << s;
+    if (s.empty() || s.back()!='\n') { out << '\n'; ++pos; }
+    pos += s.size();
+  };
+
+  for (const auto& o : objs) write_obj(o.first,o.second);
+
+  write_obj(catalog, to_string(catalog)+" 0 obj\n<<\n/Type /Catalog\n/Pages "
+    + to_string(pages_root)+" 0 R\n>>\nendobj\n");
+
+  string tree = to_string(pages_root)+" 0 obj\n<<\n/Type /Pages\n/Count "
+    + to_string(all_pages.size())+"\n/Kids [";
+  for (long p : all_pages) tree += " "+to_string(p)+" 0 R";
+  tree += " ]\n>>\nendobj\n";
+  write_obj(pages_root,tree);
+
+  // Unused object numbers are listed as free
+  map<long,size_t> offsets(xref.begin(),xref.end());
+  const long size = pages_root+1;
+  out << "xref\n0 " << size << '\n';
+  char line[21];
+  for (long i=0; i<size; ++i) {
+    auto it = offsets.find(i);
+    if (it==offsets.end())
+      snprintf(line,sizeof(line),"%010d %05d f\r\n",0,i ? 0 : 65535);
+    else
+      snprintf(line,sizeof(line),"%010lu %05d n\r\n",
+        (unsigned long)it->second,0);
+    out << line;
+  }
+  out << "trailer\n<<\n/Size " << size << "\n/Root " << catalog << " 0 R\n";
+  if (info) out << "/Info " << info << " 0 R\n";
+  out << ">>\nstartxref\n" << pos << "\n%%EOF\n";
+
+  if (!out) throw runtime_error("pdf_merge: error writing "+output);
+}
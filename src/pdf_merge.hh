@@ -0,0 +1,15 @@
+#ifndef pdf_merge_hh
+#define pdf_merge_hh
+
+#include <string>
+#include <vector>
+
+// Concatenate the pages of PDF files, in the given order, into one file.
+// Meant for ROOT's TPDF output: every input must have a classic xref
+// table and a flat page tree. Objects are renumbered and copied,
+// stream data is copied byte for byte.
+// Document outlines of the inputs are dropped.
+void pdf_merge(const std::vector<std::string>& inputs,
+               const std::string& output);
+
+#endif
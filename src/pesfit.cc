@@ -20,15 +20,18 @@ namespace std {
 // options ------------------
 senum(Fit,(none)(gaus)(cb))
 Fit::type fit_;
-senum(Out,(pdf)(root))
+senum(Out,(none)(pdf)(root))
 Out::type out_;
 
-string ofname, cfname, wfname;
+string ofname, cfname, wfname, rfname, syst_re, report_fname, partial_fname,
+       warm_fname;
 vector<string> ifname;
 vector<Color_t> colors;
 Int_t nbins;
+unsigned njobs;
 pair<double,double> xrange;
-bool logy, fix_alpha;
+pair<long long,long long> entries;
+bool logy, fix_alpha, no_plots;
 int prec;
 vector<pair<string,pair<double,double>>> new_ws_ranges;
 // --------------------------
@@ -36,10 +39,12 @@ vector<pair<string,pair<double,double>>> new_ws_ranges;
 // global -------------------
 TFile *ofile;
 workspace *ws;
-seqmap<seqmap<val_err<double>>> stats;
+pesfit_plot plot;
+stats_t& stats = plot.stats;
+unique_ptr<results_writer> results;
+unique_ptr<warm_start_store> warm;
 TTree *tree;
-TCanvas *canv;
-TLatex *lbl;
+vector<variation> vars; // found in the first input file
 // --------------------------
 
 inline Double_t get_FWHM(const TH1* hist) noexcept {
@@ -47,142 +52,118 @@ inline Double_t get_FWHM(const TH1* hist) noexcept {
   return hist->GetBinCenter(hist->FindLastBinAbove(half_max))
        - hist->GetBinCenter(hist->FindFirstBinAbove(half_max));
 }
-inline Double_t get_FWHM(const TGraph* gr) noexcept {
-  const Double_t half_max = max(gr).second/2;
-  return rfindx(gr,half_max) - lfindx(gr,half_max);
+
+void record(const string& hist, const string& var,
+            const val_err<double>& x, const char* stage) {
+  stats[hist][var] = x;
+  if (results) results->write(hist,var,x.val,x.err,stage);
 }
 
-void make_hist(TH1*& hist, const char* name, const string& proc,
-               double scale, const char* branch) {
-  if (!tree->GetListOfBranches()->Contains(branch)) return;
-
-  const string cmd1(cat(
-    branch,"/1000>>hist(",nbins,",",xrange.first,",",xrange.second,")"));
-  const string cmd2(
-    "HGamEventInfoAuxDyn.crossSectionBRfilterEff"
-    "*HGamEventInfoAuxDyn.weight"
-    "*(HGamEventInfoAuxDyn.isPassed==1)");
-  tree->Draw(cmd1.c_str(),cmd2.c_str());
-  cout << endl << name
-       << endl << cmd1
-       << endl << cmd2 << endl;
-  TH1 *temp = get<TH1>(gDirectory,"hist");
-  temp->Scale(1000.*scale/temp->GetBinWidth(1));
-
-  stats[name]["xsec_"+proc] = temp->Integral(0,temp->GetNbinsX()+1,"width");
-
-  if (!hist)
-    (hist = (TH1*)temp->Clone(name))->SetDirectory(0);
-  else hist->Add(temp);
+// Add the chunks of one input file to the histograms of all variations
+void add_file(vector<TH1*>& hists, const vector<chunk>& chunks) {
+  const string& proc = chunks.front().proc;
+  auto temps = sum_chunks(chunks);
+
+  for (size_t i=0; i<temps.size(); ++i) {
+    TH1 *temp = temps[i].get();
+    if (!temp) continue;
+    const char *name = vars[i].name.c_str();
+
+    record(name,"xsec_"+proc,
+      temp->Integral(0,temp->GetNbinsX()+1,"width"),"hist");
+
+    TH1*& hist = hists[i];
+    if (!hist) {
+      (hist = (TH1*)temp->Clone(name))->SetDirectory(0);
+      hist->SetTitle(name);
+      hist->SetXTitle("m_{#gamma#gamma} [GeV]");
+      hist->SetYTitle("d#sigma/dm_{#gamma#gamma} [fb/GeV]");
+    } else hist->Add(temp);
+  }
 }
 
-vector<FitResult> fit(const initializer_list<TH1*>& hs) {
-
-  vector<FitResult> res;
-  if (fit_==Fit::cb) res.reserve(hs.size());
-
-  int i=0;
-  Color_t color;
-  for (auto it=hs.begin(), end=hs.end(); it!=end; ++it) {
-    TH1 *hist = *it;
-    if (!hist) continue;
-
-    const char *name = hist->GetName();
-    hist->SetStats(false);
-    hist->SetLineWidth(2);
-    color = colors[(i++) % colors.size()];
-    hist->SetLineColor(color);
-    hist->SetMarkerColor(color);
-
-    hist->SetXTitle("m_{#gamma#gamma} [GeV]");
-    hist->SetYTitle("d#sigma/dm_{#gamma#gamma} [fb/GeV]");
-    hist->SetTitleOffset(1.3,"Y");
-    switch (out_) {
-      case Out::pdf:
-        if (it==hs.begin()) {
-          hist->Draw();
-          lbl->DrawLatex(.24,0.88-0.04*i,"Entries");
-          lbl->DrawLatex(.32,0.88-0.04*i,"mean");
-          lbl->DrawLatex(.40,0.88-0.04*i,"stdev");
-        } else hist->Draw("same");
-        break;
-      case Out::root:
-        hist->SetDirectory(ofile);
-        break;
-    }
+// Histogram statistics and, for gaus, the cheap gaussian fit
+void fit_hist(TH1* hist) {
+  const char *name = hist->GetName();
+  if (ofile) hist->SetDirectory(ofile);
 
-    Double_t mean  = hist->GetMean(),
-             stdev = hist->GetStdDev();
-
-    auto &hstat = stats[name];
-    hstat["hist_N"] = hist->GetEntries();
-    hstat["hist_mean"] = {mean,hist->GetMeanError()};
-    hstat["hist_stdev"] = {stdev,hist->GetStdDevError()};
-
-    hstat["hist_window_mean"] = window_mean(hist,120,130);
-
-    switch (fit_) { // FITTING +++++++++++++++++++++++++++++++++++++++
-      case Fit::none: break;
-
-      case Fit::gaus: {
-        auto fit_res = hist->Fit("gaus","S");
-        mean  = fit_res->Value(1);
-        stdev = fit_res->Value(2);
-
-        auto &hstat = stats[name];
-        hstat["gaus_mean"] = {mean,fit_res->Error(1)};
-        hstat["gaus_stdev"] = {stdev,fit_res->Error(2)};
-      break; }
-
-      case Fit::cb: {
-        cout << "\033[32mFitting " << name << "\033[0m" << endl;
-        auto fit_res = ws->fit(hist);
-        switch (out_) {
-          case Out::pdf:
-            fit_res.second->Draw("same");
-            break;
-          case Out::root:
-            auto *fit_gr = new TGraph(*fit_res.second);
-            fit_gr->SetName(cat(hist->GetName(),"_fit").c_str());
-            fit_gr->SetTitle(fit_gr->GetName());
-            ofile->Add(fit_gr);
-            break;
-        }
+  record(name,"hist_N",hist->GetEntries(),"hist");
+  record(name,"hist_mean",{hist->GetMean(),hist->GetMeanError()},"hist");
+  record(name,"hist_stdev",{hist->GetStdDev(),hist->GetStdDevError()},"hist");
 
-        auto &hstat = stats[name];
-        for (const string& varname : {
-          "crys_alpha_bin0", "crys_norm_bin0", "fcb_bin0", "gaus_kappa_bin0",
-          "gaus_mean_offset_bin0", "mean_offset_bin0", "sigma_offset_bin0"
-        }) {
-          auto *var = static_cast<RooRealVar*>(
-            fit_res.first->floatParsFinal().find(varname.c_str()));
-          hstat[varname] = {var->getVal(),var->getError()};
-        }
-        hstat["FWHM"] = get_FWHM(fit_res.second);
+  record(name,"hist_window_mean",window_mean(hist,120,130),"hist");
 
-        if (fix_alpha) if (!strcmp(name,"nominal")) {
-          auto *alpha = (*ws)->var("crys_alpha_bin0");
-          alpha->setRange(alpha->getVal(),alpha->getVal());
-        }
+  if (fit_==Fit::gaus) {
+    // don't draw, the function is kept with the histogram
+    auto fit_res = hist->Fit("gaus","S0");
+    record(name,"gaus_mean",{fit_res->Value(1),fit_res->Error(1)},"gaus");
+    record(name,"gaus_stdev",{fit_res->Value(2),fit_res->Error(2)},"gaus");
+  }
+}
 
-      res.emplace_back(move(fit_res.first));
+string warm_key(const TH1* hist) {
+  return warm_start_store::key(wfname,"mc_125",hist->GetName());
+}
 
-      break; }
-    }
+// CB fit as flat doubles, so it can be sent back from a worker:
+// whether it was warm started, converged, its likelihood evaluations,
+// val,err of every cb_pars entry, followed by the fitted curve's x,y points
+constexpr size_t nfit_info = 3;
+vector<double> fit_cb(TH1* hist, const fit_options& opt,
+                      FitResult* keep = nullptr) {
+  cout << "\033[32mFitting " << hist->GetName() << "\033[0m" << endl;
+  const bool warm_started = warm && warm->apply(*ws,warm_key(hist));
+  const auto calls = run_report::fcn_calls();
+  auto fit_res = ws->fit(hist,opt);
+  const bool ok = converged(*fit_res.first);
+  if (!ok)
+    cerr << "\033[31m" << hist->GetName() << " fit did not converge: status "
+         << fit_res.first->status() << ", covQual "
+         << fit_res.first->covQual() << ", edm "
+         << fit_res.first->edm() << "\033[0m" << endl;
+
+  vector<double> flat { double(warm_started), double(ok),
+                        double(run_report::fcn_calls()-calls) };
+  const TGraph *curve = fit_res.second;
+  flat.reserve(nfit_info + 2*ncb_pars + 2*curve->GetN());
+  for (const char* varname : cb_pars) {
+    auto *var = static_cast<RooRealVar*>(
+      fit_res.first->floatParsFinal().find(varname));
+    flat.push_back(var->getVal());
+    flat.push_back(var->getError());
+  }
+  for (int i=0, n=curve->GetN(); i<n; ++i) {
+    flat.push_back(curve->GetX()[i]);
+    flat.push_back(curve->GetY()[i]);
+  }
+  if (keep) *keep = move(fit_res.first);
+  return flat;
+}
 
-    if (out_==Out::pdf) {
-      auto lblp = lbl->DrawLatex(.12,0.84-0.04*i,hist->GetName());
-      lblp->SetTextColor(color);
-      lblp->DrawLatex(.24,0.84-0.04*i,cat(hist->GetEntries()).c_str());
-      lblp->DrawLatex(.32,0.84-0.04*i,
-        cat(fixed,setprecision(2),mean).c_str());
-      lblp->DrawLatex(.40,0.84-0.04*i,
-        cat(fixed,setprecision(2),stdev).c_str());
-    }
+void record_cb(TH1* hist, const vector<double>& fit) {
+  const char *name = hist->GetName();
+  const double *flat = fit.data() + nfit_info;
+
+  if (warm && fit[1]) {
+    warm_start_store::entry e;
+    for (size_t i=0; i<ncb_pars; ++i)
+      e.pars.push_back({cb_pars[i],{flat[2*i],flat[2*i+1]}});
+    e.calls = fit[2];
+    warm->update(warm_key(hist),std::move(e),fit[0]);
   }
-  if (out_==Out::pdf) if (i) canv->SaveAs(ofname.c_str());
 
-  return res;
+  const int n = (fit.size() - nfit_info - 2*ncb_pars)/2;
+  auto *fit_gr = new TGraph(n);
+  for (int i=0; i<n; ++i)
+    fit_gr->SetPoint(i,flat[2*(ncb_pars+i)],flat[2*(ncb_pars+i)+1]);
+  fit_gr->SetName(cat(name,"_fit").c_str());
+  fit_gr->SetTitle(fit_gr->GetName());
+  plot.fits[name] = fit_gr;
+  if (ofile) ofile->Add(fit_gr);
+
+  for (size_t i=0; i<ncb_pars; ++i)
+    record(name,cb_pars[i],{flat[2*i],flat[2*i+1]},"fit");
+  record(name,"FWHM",fwhm(fit_gr),"fit");
 }
 
 int main(int argc, char** argv)
@@ -193,17 +174,25 @@ int main(int argc, char** argv)
     desc.add_options()
       ("input,i", po::value(&ifname)->multitoken()->required(),
        "*input root file names")
-      ("output,o", po::value(&ofname)->required(),
+      ("output,o", po::value(&ofname),
        "*output pdf or root file name")
+      ("results,r", po::value(&rfname),
+       "stream results to .ndjson or binary .pesr file")
       ("config,c", po::value(&cfname),
        "configuration file name")
 
+      ("no-plots", po::bool_switch(&no_plots),
+       "compute only, output must be root or --results;\n"
+       "pdf pages can be made later with pesrender")
       ("logy,l", po::bool_switch(&logy),
        "logarithmic Y axis")
       ("fit,f", po::value(&fit_)->default_value(Fit::none),
        cat("fit type: ",Fit::_str_all()).c_str())
       ("workspace,w", po::value(&wfname)->default_value("data/ws.root"),
        "ROOT file with RooWorkspace for CB fits")
+      ("syst,s",
+       po::value(&syst_re)->default_value("EG_(SCALE|RESOLUTION)_ALL"),
+       "regex of systematics with m_yy variations, \".*\" for all")
       ("fix-alpha", po::bool_switch(&fix_alpha),
        "fix crys_alpha_bin0 parameter after nominal fit")
       ("xrange,x", po::value(&xrange)->default_value({105,140},"105:140"),
@@ -215,6 +204,20 @@ int main(int argc, char** argv)
       ("colors", po::value(&colors)->multitoken()->
         default_value(decltype(colors)({602,46}), "{602,46}"),
        "histograms\' colors")
+      ("jobs,j", po::value(&njobs)->default_value(4),
+       "number of worker processes for fits and pdf pages")
+      ("report", po::value(&report_fname),
+       "write JSON report of stage timing and counters at exit")
+      ("partial", po::value(&partial_fname),
+       "only fill histograms and write them to this partial file,\n"
+       "partial files given as input are merged and fitted")
+      ("entries", po::value(&entries)->default_value({0,-1},"0:-1"),
+       cat("entry range first:last of input files for --partial,\n"
+           "first must be a multiple of ",chunk_entries).c_str())
+
+      ("warm-start", po::value(&warm_fname),
+       "start CB fits from the parameters stored in this file\n"
+       "by the previous run, and store the converged ones")
 
       ("ws-setRange", po::value(&new_ws_ranges),
        "call RooWorkspace::setRange()")
@@ -236,12 +239,26 @@ int main(int argc, char** argv)
     }
     po::notify(vm);
 
-    const string ofext = ofname.substr(ofname.rfind('.')+1);
-    if (ofext=="pdf") out_ = Out::pdf;
-    else if (ofext=="root") out_ = Out::root;
-    else throw runtime_error(
-      "Output file extension "+ofext+" is not pdf or root"
-    );
+    if (partial_fname.empty() && !vm["entries"].defaulted())
+      throw runtime_error("--entries requires --partial");
+    if (!partial_fname.empty()) {
+      if (!ofname.empty()) throw runtime_error(
+        "--partial writes no output, fit by passing partials as input");
+      out_ = Out::none;
+    } else if (ofname.empty()) {
+      if (!(no_plots && vm.count("results"))) throw runtime_error(
+        "the option '--output' is required but missing");
+      out_ = Out::none;
+    } else {
+      const string ofext = ofname.substr(ofname.rfind('.')+1);
+      if (ofext=="pdf") out_ = Out::pdf;
+      else if (ofext=="root") out_ = Out::root;
+      else throw runtime_error(
+        "Output file extension "+ofext+" is not pdf or root"
+      );
+    }
+    if (no_plots && out_==Out::pdf) throw runtime_error(
+      "--no-plots cannot write pdf output");
 
   } catch (std::exception& e) {
     cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
@@ -249,246 +266,192 @@ int main(int argc, char** argv)
   }
   // end options ---------------------------------------------------
 
-  if (out_==Out::root) ofile = new TFile(ofname.c_str(),"recreate");
+  if (!report_fname.empty()) run_report::write_at_exit(report_fname,argv[0]);
+
+  // never initialize graphics when only numbers are needed
+  if (no_plots) gROOT->SetBatch(true);
 
-  ws = new workspace(wfname);
-  for (const auto& range : new_ws_ranges)
-    ws->setRange(range.first.c_str(),range.second.first,range.second.second);
-
-  TH1 *nom=nullptr,
-      *scale_down=nullptr, *scale_up=nullptr,
-      *res_down=nullptr,   *res_up=nullptr;
-
-  // LOOP over input files
-  for (const string& f : ifname) {
-    TFile *file = new TFile(f.c_str(),"read");
-    if (file->IsZombie()) return 1;
-    cout << "Data file: " << f << endl;
-    tree = get<TTree>(file,"CollectionTree");
-
-    const size_t slash = f.rfind('/')+1;
-    const double xsecscale = 1./get<TH1>(file,
-      ("CutFlow_"+f.substr(slash,f.find('.')-slash)+"_weighted").c_str()
-    )->GetBinContent(3);
-
-    // Regex for process identification
-    static regex proc_re(".*[\\._]?(gg.|VBF|ttH|WH|ZH)[0-9]*[\\._]?.*",
-                         regex_icase);
-    smatch proc_match;
-    if (!regex_match(f, proc_match, proc_re))
-      throw runtime_error(cat("Filename \"",f,"\" does not specify process"));
-    const string proc(proc_match.str(1));
-
-    // protect from repeated processes
-    static unordered_set<string> procs;
-    if (!procs.emplace(proc).second)
-      throw runtime_error(cat("File \"",f,"\" repeats process ",proc));
-
-    // Make or add histograms
-    make_hist(nom,"nominal",proc,xsecscale,
-              "HGamEventInfoAuxDyn.m_yy");
-    make_hist(scale_down,"scale_down",proc,xsecscale,
-              "HGamEventInfo_EG_SCALE_ALL__1downAuxDyn.m_yy");
-    make_hist(scale_up,"scale_up",proc,xsecscale,
-              "HGamEventInfo_EG_SCALE_ALL__1upAuxDyn.m_yy");
-    make_hist(res_down,"res_down",proc,xsecscale,
-              "HGamEventInfo_EG_RESOLUTION_ALL__1downAuxDyn.m_yy");
-    make_hist(res_up,"res_up",proc,xsecscale,
-              "HGamEventInfo_EG_RESOLUTION_ALL__1upAuxDyn.m_yy");
-
-    delete file;
+  if (out_==Out::root) ofile = new TFile(ofname.c_str(),"recreate");
+  if (!rfname.empty()) results = make_results_writer(rfname);
+
+  if (partial_fname.empty()) { // partial runs don't fit
+    timed_stage stage("workspace");
+    ws = new workspace(wfname);
+    for (const auto& range : new_ws_ranges)
+      ws->setRange(range.first.c_str(),range.second.first,range.second.second);
+    if (!warm_fname.empty())
+      warm.reset(new warm_start_store(warm_fname));
   }
-  cout << endl;
 
-  // ---------------------------------------
+  vector<TH1*> hists;
+
+  // Files are read in name order, the order in which merged partials
+  // are summed, so a split and merged run gives identical results
+  std::stable_sort(ifname.begin(),ifname.end(),
+    [](const string& a, const string& b){
+      return file_base(a) < file_base(b);
+    });
+
+  if (is_partial(ifname.front())) {
+    timed_stage stage("read");
+    auto chunks = read_partials(ifname,vars,nbins,xrange);
+    hists.assign(vars.size(),nullptr);
+
+    process_set procs;
+    for (auto it=chunks.begin(); it!=chunks.end(); ) {
+      auto end = std::find_if(it,chunks.end(),
+        [it](const chunk& c){ return c.file!=it->file; });
+      procs.add(it->file,it->proc);
+      // chunks are moved in and out of the vector, they are not copyable
+      add_file(hists,vector<chunk>(
+        std::make_move_iterator(it),std::make_move_iterator(end)));
+      it = end;
+    }
+  } else {
+    vector<chunk> partial;
+
+    // LOOP over input files
+    for (const string& f : ifname) {
+      timed_stage stage("read");
+      TFile *file = new TFile(f.c_str(),"read");
+      if (file->IsZombie()) return 1;
+      cout << "Data file: " << f << endl;
+      tree = get<TTree>(file,"CollectionTree");
+
+      const string fbase = file_base(f);
+      const double xsecscale = cutflow_scale(file,f);
+      const string proc = file_process(f);
+      static process_set procs;
+      procs.add(f,proc);
+
+      if (vars.empty()) {
+        vars = find_variations(tree,syst_re);
+        hists.assign(vars.size(),nullptr);
+        cout << "Variations:" << endl;
+        for (const auto& var : vars)
+          cout << "  " << var.name << ": " << var.branch << endl;
+      }
 
-  if (out_==Out::pdf) {
-    canv = new TCanvas();
-    canv->SetMargin(0.1,0.04,0.1,0.1);
-    if (logy) canv->SetLogy();
-    canv->SaveAs((ofname+'[').c_str());
-
-    lbl = new TLatex();
-    lbl->SetTextFont(43);
-    lbl->SetTextSize(15);
-    lbl->SetNDC();
-  }
+      // Make or add histograms
+      auto chunks = fill_chunks(tree,vars,nbins,xrange,fbase,proc,xsecscale,
+                                entries.first,entries.second);
+      if (!partial_fname.empty())
+        partial.insert(partial.end(),
+          std::make_move_iterator(chunks.begin()),
+          std::make_move_iterator(chunks.end()));
+      else if (!chunks.empty())
+        add_file(hists,chunks);
+
+      delete file;
+    }
 
-  TH2 *corr = fit({nom}).front()
-    ->correlationHist("corr_mat");
-  corr->SetTitle("Nominal signal fit correlation matrix");
-
-  switch (out_) {
-    case Out::pdf:
-      if (logy) canv->SetLogy(false);
-      gStyle->SetPaintTextFormat(".3f");
-      canv->SetMargin(0.17,0.12,0.1,0.1);
-      corr->SetStats(false);
-      corr->SetMarkerSize(1.8);
-      corr->Draw("COLZ TEXT");
-      canv->SaveAs(ofname.c_str());
-      canv->SetMargin(0.1,0.04,0.1,0.1);
-      if (logy) canv->SetLogy(true);
-      break;
-    case Out::root:
-      corr->SetDirectory(ofile);
-      break;
+    if (!partial_fname.empty()) {
+      timed_stage stage("write");
+      write_partial(partial_fname,vars,nbins,xrange,partial);
+      cout << "Wrote " << partial.size() << " chunks to "
+           << partial_fname << endl;
+      return 0;
+    }
   }
+  cout << endl;
 
-  fit({scale_down,scale_up});
-  fit({res_down,res_up});
+  // ---------------------------------------
 
-  // Print summary page *********************************************
-  if (out_==Out::pdf) {
-    canv->Clear();
-    vector<unique_ptr<TPaveText>> txt;
-    int i, n=6;
-    txt.reserve(n);
-    for (i=0; i<n; ++i) {
-      TPaveText *pt;
-      txt.emplace_back(pt = new TPaveText(float(i)/n,0.,float(i+1)/n,1.,"NBNDC"));
-      pt->SetFillColor(0);
+  {
+    vector<TH1*> hs;
+    for (TH1 *h : hists) if (h) hs.push_back(h);
+    plot.groups = group_variations(hs);
+    {
+      timed_stage stage("hist stats");
+      for (TH1 *h : hs) fit_hist(h);
     }
-    i=1;
-    int m = 1;
-    txt[0]->AddText("");
-    for (auto& hist : stats) {
-      txt[i]->AddText(hist.first.c_str());
-      for (auto& var : hist.second) {
-        if (i==1) {
-          txt[0]->AddText(var.first.c_str());
-          ++m;
-        }
-        stringstream ss;
-        if (var.first.substr(0,var.first.find('_'))=="xsec") {
-          ss << setprecision(3) << var.second.val;
-        } else if (var.first.substr(var.first.rfind('_')+1)=="N") {
-          ss << fixed << setprecision(0) << var.second.val;
-        } else {
-          if (prec==-1) var.second.print(ss," #pm ");
-          else ss << scientific << setprecision(prec) << var.second.val;
+    if (fit_==Fit::cb && !hs.empty()) {
+      // nominal is fitted first, for its correlation matrix,
+      // and because the other fits may depend on it
+      auto it = hs.begin();
+      if (!strcmp((*it)->GetName(),"nominal")) {
+        timed_stage stage("nominal fit");
+        FitResult nom_res;
+        record_cb(*it,fit_cb(*it,fit_options(),&nom_res));
+        plot.corr = nom_res->correlationHist("corr_mat");
+        plot.corr->SetTitle("Nominal signal fit correlation matrix");
+        if (ofile) plot.corr->SetDirectory(ofile);
+
+        if (fix_alpha) {
+          auto *alpha = (*ws)->var("crys_alpha_bin0");
+          alpha->setRange(alpha->getVal(),alpha->getVal());
         }
-        txt[i]->AddText(ss.str().c_str());
+        ++it;
+      }
+
+      // the rest are independent, fit them on a pool of workers,
+      // every one from the same start, so that the results don't
+      // depend on which fits a worker did before
+      timed_stage stage("variation fits");
+      const vector<TH1*> rest(it,hs.end());
+      const auto start = ws->save();
+      fit_options opt;
+      opt.verbose = njobs < 2;
+      if (njobs > 1) opt.ncpu = 1;
+      const auto flats = fork_map(rest.size(), njobs, [&](size_t i){
+        ws->restore(start);
+        const auto flat = fit_cb(rest[i],opt);
+        return string(reinterpret_cast<const char*>(flat.data()),
+                      flat.size()*sizeof(double));
+      });
+      for (size_t i=0; i<rest.size(); ++i) {
+        const double *begin = reinterpret_cast<const double*>(flats[i].data());
+        record_cb(rest[i],
+          vector<double>(begin,begin+flats[i].size()/sizeof(double)));
+      }
+
+      if (warm) {
+        warm->write();
+        warm->print_savings(cout);
       }
-      ++i;
-    }
-    TLine *line = new TLine();
-    for (i=0; i<n; ++i) {
-      txt[i]->Draw();
-      if (i) line->DrawLineNDC(float(i)/n,0.,float(i)/n,1.);
     }
-    for (i=1; i<m; ++i) line->DrawLineNDC(0.,float(i)/m,1.,float(i)/m);
-    canv->SaveAs(ofname.c_str());
   }
-  // ****************************************************************
-
-  if (fit_==Fit::cb && out_==Out::pdf) {
-    double scale      = stats["nominal"   ]["mean_offset_bin0"].val;
-    double scale_down = stats["scale_down"]["mean_offset_bin0"].val;
-    double scale_up   = stats["scale_up"  ]["mean_offset_bin0"].val;
-           scale_down = scale_down - scale;
-           scale_up   = scale_up   - scale;
-    double scale_sym  = (scale_up-scale_down)/2;
-
-    double win        = stats["nominal"   ]["hist_window_mean"].val;
-    double win_down   = stats["scale_down"]["hist_window_mean"].val;
-    double win_up     = stats["scale_up"  ]["hist_window_mean"].val;
-           win_down   = win_down - win;
-           win_up     = win_up   - win;
-    double win_sym    = (win_up-win_down)/2;
-
-    double res        = stats["nominal"   ]["sigma_offset_bin0"].val;
-    double res_down   = stats["res_down"  ]["sigma_offset_bin0"].val;
-    double res_up     = stats["res_up"    ]["sigma_offset_bin0"].val;
-           res_down   = res_down - res;
-           res_up     = res_up   - res;
-    double res_sym    = (res_up-res_down)/2;
-
-    double fwhm       = stats["nominal"   ]["FWHM"].val;
-    double fwhm_down  = stats["res_down"  ]["FWHM"].val;
-    double fwhm_up    = stats["res_up"    ]["FWHM"].val;
-           fwhm_down  = fwhm_down - fwhm;
-           fwhm_up    = fwhm_up   - fwhm;
-    double fwhm_sym   = (fwhm_up-fwhm_down)/2;
-
-    canv->Clear();
-    vector<unique_ptr<TPaveText>> txt;
-    txt.reserve(6);
-    for (int i=0; i<6; ++i) {
-      TPaveText *pt;
-      txt.emplace_back(pt = new TPaveText(i/6.,0.,(i+1)/6.,1.,"NBNDC"));
-      pt->SetFillColor(0);
-    }
 
-    txt[0]->AddText("[GeV]");
-    txt[1]->AddText("Scale");
-    txt[2]->AddText("Window");
-    txt[3]->AddText("Resolution");
-    txt[4]->AddText("HWHM");
-    txt[5]->AddText("FWHM/FWHM_{nom}");
-
-    txt[0]->AddText("Nominal");
-    txt[1]->AddText(Form("%.3f",scale));
-    txt[2]->AddText(Form("%.3f",win));
-    txt[3]->AddText(Form("%.3f",res));
-    txt[4]->AddText(Form("%.3f",fwhm/2));
-    txt[5]->AddText("1");
-
-    txt[0]->AddText("Variation");
-    txt[1]->AddText(Form("%.3f, +%.3f",scale_down,scale_up));
-    txt[2]->AddText(Form("%.3f, +%.3f",win_down,win_up));
-    txt[3]->AddText(Form("%.3f, +%.3f",res_down,res_up));
-    txt[4]->AddText(Form("%.3f, +%.3f",fwhm_down/2,fwhm_up/2));
-    txt[5]->AddText(Form("%.3f, +%.3f",fwhm_down/fwhm,fwhm_up/fwhm));
-
-    txt[0]->AddText("Average Variation");
-    txt[1]->AddText(Form("#pm %.3f",scale_sym));
-    txt[2]->AddText(Form("#pm %.3f",win_sym));
-    txt[3]->AddText(Form("#pm %.3f",res_sym));
-    txt[4]->AddText(Form("#pm %.3f",fwhm_sym/2));
-    txt[5]->AddText(Form("#pm %.3f",fwhm_sym/fwhm));
-
-    TLine *line = new TLine();
-
-    for (int i=0; i<6; ++i) {
-      txt[i]->Draw();
-      if (i) line->DrawLineNDC(i/6.,0.,i/6.,1.);
-    }
-    for (int i=1; i<4; ++i) line->DrawLineNDC(0.,i/4.,1.,i/4.);
-    canv->SaveAs(ofname.c_str());
+  if (out_==Out::pdf) {
+    plot.logy = logy;
+    plot.prec = prec;
+    plot.colors = colors;
+    save_pages(ofname,pesfit_pages(plot),njobs);
   }
 
+  timed_stage stage("write");
   if (out_==Out::root) {
     ofile->cd();
     TTree *tree = new TTree("stats","stats");
 
-    structmap(val_err<double>,hist_t,
-      (nominal)(scale_down)(scale_up)(res_down)(res_up));
-
-    seqmap<hist_t> tstats;
+    // a branch per quantity, with a val,err leaf pair per variation
+    string leaves;
     for (auto& hist : stats)
-      for (auto& var : hist.second)
-        tstats[var.first][hist.first] = var.second;
+      leaves += (leaves.empty() ? "" : ":") + hist.first + "[2]/D";
+
+    seqmap<vector<val_err<double>>> tstats;
+    size_t i=0;
+    for (auto& hist : stats) {
+      for (auto& var : hist.second) {
+        auto& stat = tstats[var.first];
+        stat.resize(stats.size());
+        stat[i] = var.second;
+      }
+      ++i;
+    }
 
     for (auto& stat : tstats)
-      tree->Branch(stat.first.c_str(), &stat.second,
-        "nominal[2]/D:scale_down[2]/D:scale_up[2]/D:res_down[2]/D:res_up[2]/D");
+      tree->Branch(stat.first.c_str(), stat.second.data(), leaves.c_str());
 
     tree->Fill();
   }
 
-  switch (out_) {
-    case Out::pdf:
-      canv->SaveAs((ofname+']').c_str());
-      delete canv;
-      delete lbl;
-      break;
-    case Out::root:
-      ofile->Write(0,TObject::kOverwrite);
-      ofile->Close();
-      delete ofile;
-      break;
+  if (ofile) {
+    ofile->Write(0,TObject::kOverwrite);
+    ofile->Close();
+    delete ofile;
   }
+  results.reset();
 
   return 0;
 }
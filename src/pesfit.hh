@@ -7,6 +7,8 @@
 #include <unordered_set>
 #include <initializer_list>
 #include <memory>
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
 
 #include <boost/program_options.hpp>
@@ -25,6 +27,7 @@
 #include <TPaveText.h>
 #include <TLine.h>
 #include <TMath.h>
+#include <TROOT.h>
 
 #include <RooWorkspace.h>
 #include <RooRealVar.h>
@@ -39,12 +42,18 @@
 #include "catstr.hh"
 #include "senum.hh"
 #include "seqmap.hh"
-#include "structmap.hh"
 #include "val_err.hh"
 #include "TGraph_fcns.hh"
 #include "root_safe_get.hh"
 #include "workspace.hh"
 #include "window_mean.hh"
+#include "results.hh"
+#include "variations.hh"
+#include "partials.hh"
+#include "warm_start.hh"
+#include "inputs.hh"
+#include "fork_pool.hh"
+#include "pesfit_pages.hh"
 
 using std::cout;
 using std::cerr;
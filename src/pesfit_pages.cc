@@ -0,0 +1,228 @@
+#include "pesfit_pages.hh"
+
+#include <sstream>
+#include <iomanip>
+
+#include <TH1.h>
+#include <TH2.h>
+#include <TF1.h>
+#include <TList.h>
+#include <TGraph.h>
+#include <TStyle.h>
+#include <TCanvas.h>
+#include <TLatex.h>
+#include <TPaveText.h>
+#include <TLine.h>
+
+#include "catstr.hh"
+
+using namespace std;
+
+namespace {
+
+template<typename T>
+const T* find(const seqmap<T>& m, string_view key) {
+  auto it = m.find(key);
+  return it==m.end() ? nullptr : &it->second;
+}
+
+// Pave owned by the pad, deleted when the canvas is cleared
+TPaveText* new_pave(double x1, double y1, double x2, double y2) {
+  TPaveText *pt = new TPaveText(x1,y1,x2,y2,"NBNDC");
+  pt->SetFillColor(0);
+  pt->SetBit(TObject::kCanDelete);
+  return pt;
+}
+
+void hists_page(TCanvas& canv, pesfit_plot& p, const vector<TH1*>& group) {
+  canv.SetMargin(0.1,0.04,0.1,0.1);
+  canv.SetLogy(p.logy);
+
+  TLatex lbl;
+  lbl.SetTextFont(43);
+  lbl.SetTextSize(15);
+  lbl.SetNDC();
+
+  int i=0;
+  for (TH1* hist : group) {
+    const char *name = hist->GetName();
+    const Color_t color = p.colors[(i++) % p.colors.size()];
+    hist->SetStats(false);
+    hist->SetLineWidth(2);
+    hist->SetLineColor(color);
+    hist->SetMarkerColor(color);
+    hist->SetTitleOffset(1.3,"Y");
+
+    // gaus fits are done without drawing
+    for (TObject *f : *hist->GetListOfFunctions())
+      f->ResetBit(TF1::kNotDraw);
+
+    if (i==1) {
+      hist->Draw();
+      lbl.DrawLatex(.24,0.88-0.04*i,"Entries");
+      lbl.DrawLatex(.32,0.88-0.04*i,"mean");
+      lbl.DrawLatex(.40,0.88-0.04*i,"stdev");
+    } else hist->Draw("same");
+
+    if (auto *fit = find(p.fits,name)) (*fit)->Draw("same");
+
+    const auto& hstat = p.stats[name];
+    const auto *mean  = find(hstat,"gaus_mean");
+    const auto *stdev = find(hstat,"gaus_stdev");
+    if (!mean)  mean  = find(hstat,"hist_mean");
+    if (!stdev) stdev = find(hstat,"hist_stdev");
+
+    auto lblp = lbl.DrawLatex(.12,0.84-0.04*i,name);
+    lblp->SetTextColor(color);
+    lblp->DrawLatex(.24,0.84-0.04*i,cat(hist->GetEntries()).c_str());
+    if (mean) lblp->DrawLatex(.32,0.84-0.04*i,
+      cat(fixed,setprecision(2),mean->val).c_str());
+    if (stdev) lblp->DrawLatex(.40,0.84-0.04*i,
+      cat(fixed,setprecision(2),stdev->val).c_str());
+  }
+}
+
+void corr_page(TCanvas& canv, pesfit_plot& p) {
+  canv.SetLogy(false);
+  gStyle->SetPaintTextFormat(".3f");
+  canv.SetMargin(0.17,0.12,0.1,0.1);
+  p.corr->SetStats(false);
+  p.corr->SetMarkerSize(1.8);
+  p.corr->Draw("COLZ TEXT");
+}
+
+void summary_page(TCanvas& canv, pesfit_plot& p) {
+  canv.SetLogy(false);
+  const int n = p.stats.size()+1;
+  vector<TPaveText*> txt(n);
+  for (int i=0; i<n; ++i) txt[i] = new_pave(float(i)/n,0.,float(i+1)/n,1.);
+
+  int i=1, m=1;
+  txt[0]->AddText("");
+  for (auto& hist : p.stats) {
+    txt[i]->AddText(hist.first.c_str());
+    for (auto& var : hist.second) {
+      if (i==1) {
+        txt[0]->AddText(var.first.c_str());
+        ++m;
+      }
+      stringstream ss;
+      if (var.first.substr(0,var.first.find('_'))=="xsec") {
+        ss << setprecision(3) << var.second.val;
+      } else if (var.first.substr(var.first.rfind('_')+1)=="N") {
+        ss << fixed << setprecision(0) << var.second.val;
+      } else {
+        if (p.prec==-1) var.second.print(ss," #pm ");
+        else ss << scientific << setprecision(p.prec) << var.second.val;
+      }
+      txt[i]->AddText(ss.str().c_str());
+    }
+    ++i;
+  }
+  TLine line;
+  for (i=0; i<n; ++i) {
+    txt[i]->Draw();
+    if (i) line.DrawLineNDC(float(i)/n,0.,float(i)/n,1.);
+  }
+  for (i=1; i<m; ++i) line.DrawLineNDC(0.,float(i)/m,1.,float(i)/m);
+}
+
+void syst_page(TCanvas& canv, pesfit_plot& p) {
+  auto& stats = p.stats;
+
+  double scale      = stats["nominal"   ]["mean_offset_bin0"].val;
+  double scale_down = stats["scale_down"]["mean_offset_bin0"].val;
+  double scale_up   = stats["scale_up"  ]["mean_offset_bin0"].val;
+         scale_down = scale_down - scale;
+         scale_up   = scale_up   - scale;
+  double scale_sym  = (scale_up-scale_down)/2;
+
+  double win        = stats["nominal"   ]["hist_window_mean"].val;
+  double win_down   = stats["scale_down"]["hist_window_mean"].val;
+  double win_up     = stats["scale_up"  ]["hist_window_mean"].val;
+         win_down   = win_down - win;
+         win_up     = win_up   - win;
+  double win_sym    = (win_up-win_down)/2;
+
+  double res        = stats["nominal"   ]["sigma_offset_bin0"].val;
+  double res_down   = stats["res_down"  ]["sigma_offset_bin0"].val;
+  double res_up     = stats["res_up"    ]["sigma_offset_bin0"].val;
+         res_down   = res_down - res;
+         res_up     = res_up   - res;
+  double res_sym    = (res_up-res_down)/2;
+
+  double fwhm       = stats["nominal"   ]["FWHM"].val;
+  double fwhm_down  = stats["res_down"  ]["FWHM"].val;
+  double fwhm_up    = stats["res_up"    ]["FWHM"].val;
+         fwhm_down  = fwhm_down - fwhm;
+         fwhm_up    = fwhm_up   - fwhm;
+  double fwhm_sym   = (fwhm_up-fwhm_down)/2;
+
+  canv.SetLogy(false);
+  vector<TPaveText*> txt(6);
+  for (int i=0; i<6; ++i) txt[i] = new_pave(i/6.,0.,(i+1)/6.,1.);
+
+  txt[0]->AddText("[GeV]");
+  txt[1]->AddText("Scale");
+  txt[2]->AddText("Window");
+  txt[3]->AddText("Resolution");
+  txt[4]->AddText("HWHM");
+  txt[5]->AddText("FWHM/FWHM_{nom}");
+
+  txt[0]->AddText("Nominal");
+  txt[1]->AddText(Form("%.3f",scale));
+  txt[2]->AddText(Form("%.3f",win));
+  txt[3]->AddText(Form("%.3f",res));
+  txt[4]->AddText(Form("%.3f",fwhm/2));
+  txt[5]->AddText("1");
+
+  txt[0]->AddText("Variation");
+  txt[1]->AddText(Form("%.3f, +%.3f",scale_down,scale_up));
+  txt[2]->AddText(Form("%.3f, +%.3f",win_down,win_up));
+  txt[3]->AddText(Form("%.3f, +%.3f",res_down,res_up));
+  txt[4]->AddText(Form("%.3f, +%.3f",fwhm_down/2,fwhm_up/2));
+  txt[5]->AddText(Form("%.3f, +%.3f",fwhm_down/fwhm,fwhm_up/fwhm));
+
+  txt[0]->AddText("Average Variation");
+  txt[1]->AddText(Form("#pm %.3f",scale_sym));
+  txt[2]->AddText(Form("#pm %.3f",win_sym));
+  txt[3]->AddText(Form("#pm %.3f",res_sym));
+  txt[4]->AddText(Form("#pm %.3f",fwhm_sym/2));
+  txt[5]->AddText(Form("#pm %.3f",fwhm_sym/fwhm));
+
+  TLine line;
+  for (int i=0; i<6; ++i) {
+    txt[i]->Draw();
+    if (i) line.DrawLineNDC(i/6.,0.,i/6.,1.);
+  }
+  for (int i=1; i<4; ++i) line.DrawLineNDC(0.,i/4.,1.,i/4.);
+}
+
+}
+
+vector<page_t> pesfit_pages(pesfit_plot& plot) {
+  pesfit_plot *p = &plot;
+  vector<page_t> pages;
+
+  bool first = true;
+  for (const auto& group : plot.groups) {
+    vector<TH1*> hs;
+    for (TH1* h : group) if (h) hs.push_back(h);
+    if (hs.empty()) continue;
+
+    pages.emplace_back([p,hs](TCanvas& canv){ hists_page(canv,*p,hs); });
+
+    // correlation matrix follows the nominal fit
+    if (first && plot.corr)
+      pages.emplace_back([p](TCanvas& canv){ corr_page(canv,*p); });
+    first = false;
+  }
+
+  pages.emplace_back([p](TCanvas& canv){ summary_page(canv,*p); });
+
+  if (const auto *nom = find(plot.stats,"nominal"))
+    if (find(*nom,"mean_offset_bin0"))
+      pages.emplace_back([p](TCanvas& canv){ syst_page(canv,*p); });
+
+  return pages;
+}
@@ -0,0 +1,36 @@
+#ifndef pesfit_pages_hh
+#define pesfit_pages_hh
+
+#include <vector>
+
+#include <Rtypes.h>
+
+#include "seqmap.hh"
+#include "val_err.hh"
+#include "pages.hh"
+
+class TH1;
+class TH2;
+class TGraph;
+
+using stats_t = seqmap<seqmap<val_err<double>>>; // stats[hist][var]
+
+// Everything that goes on pesfit's pdf pages.
+// Filled either by pesfit directly or by pesrender from pesfit's root output.
+struct pesfit_plot {
+  std::vector<std::vector<TH1*>> groups; // histograms drawn together
+  seqmap<TGraph*> fits; // fitted curves by histogram name
+  TH2 *corr;
+  stats_t stats;
+
+  bool logy;
+  int prec;
+  std::vector<Color_t> colors;
+
+  pesfit_plot(): corr(nullptr), logy(false), prec(-1) { }
+};
+
+// Pages reference the plot, which must outlive them
+std::vector<page_t> pesfit_pages(pesfit_plot& plot);
+
+#endif
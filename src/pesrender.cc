@@ -0,0 +1,108 @@
+// Draw pesfit's pdf pages from its root output,
+// e.g. after a pesfit --no-plots run
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TH2.h>
+#include <TGraph.h>
+#include <TKey.h>
+#include <TClass.h>
+#include <TROOT.h>
+
+#include "catstr.hh"
+#include "val_err.hh"
+#include "root_safe_get.hh"
+#include "results.hh"
+#include "variations.hh"
+#include "pesfit_pages.hh"
+
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, char** argv)
+{
+  string ifname, ofname, rfname;
+  unsigned njobs;
+  pesfit_plot plot;
+
+  // options ---------------------------------------------------
+  try {
+    po::options_description desc("Options");
+    desc.add_options()
+      ("input,i", po::value(&ifname)->required(),
+       "*pesfit root output file")
+      ("output,o", po::value(&ofname)->required(),
+       "*output pdf file name")
+      ("results,r", po::value(&rfname),
+       "read stats from pesfit .ndjson or .pesr results file\n"
+       "instead of the stats tree")
+
+      ("logy,l", po::bool_switch(&plot.logy),
+       "logarithmic Y axis")
+      ("prec", po::value(&plot.prec)->default_value(-1),
+       "summary table precision, -1 prints uncertainty")
+      ("colors", po::value(&plot.colors)->multitoken()->
+        default_value(decltype(plot.colors)({602,46}), "{602,46}"),
+       "histograms\' colors")
+      ("jobs,j", po::value(&njobs)->default_value(4),
+       "number of worker processes drawing pdf pages")
+    ;
+
+    po::positional_options_description pos;
+    pos.add("input",1);
+    pos.add("output",1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv)
+      .options(desc).positional(pos).run(), vm);
+    if (argc == 1) {
+      cout << desc << endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch (std::exception& e) {
+    cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
+    return 1;
+  }
+  // end options ---------------------------------------------------
+
+  gROOT->SetBatch(true);
+
+  TFile *fin = new TFile(ifname.c_str(),"read");
+  if (fin->IsZombie()) return 1;
+
+  // variation histograms in the order pesfit wrote them
+  vector<TH1*> hists;
+  for (auto *k : *fin->GetListOfKeys()) {
+    TKey *key = static_cast<TKey*>(k);
+    TClass *cl = TClass::GetClass(key->GetClassName());
+    if (!cl->InheritsFrom(TH1::Class()) || cl->InheritsFrom(TH2::Class()))
+      continue;
+    TH1 *h = static_cast<TH1*>(key->ReadObj());
+    const string name = h->GetName();
+    hists.push_back(h);
+    if (auto *fit = dynamic_cast<TGraph*>(fin->Get((name+"_fit").c_str())))
+      plot.fits[name] = fit;
+    plot.stats[name]; // only histograms in the file get stats
+  }
+  plot.groups = group_variations(hists);
+  plot.corr = dynamic_cast<TH2*>(fin->Get("corr_mat"));
+
+  for (const auto& r : rfname.empty()
+         ? read_stats_tree(get<TTree>(fin,"stats")) : read_results(rfname))
+    if (plot.stats.count(r.variation))
+      plot.stats[r.variation][r.name] = {r.val,r.err};
+
+  save_pages(ofname,pesfit_pages(plot),njobs);
+
+  delete fin;
+  return 0;
+}
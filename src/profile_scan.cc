@@ -0,0 +1,150 @@
+#include "profile_scan.hh"
+
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include <TH1.h>
+#include <TGraph.h>
+
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooFitResult.h>
+
+#include "catstr.hh"
+
+using namespace std;
+
+pair<double,double> profile_scan::crossings(double dnll) const {
+  pair<double,double> x { NAN, NAN };
+  if (points.empty()) return x;
+  const size_t m = min_element(points.begin(),points.end(),
+    [](const profile_point& a, const profile_point& b){
+      return a.dnll < b.dnll;
+    }) - points.begin();
+
+  auto cross = [&](const profile_point& in, const profile_point& out){
+    return in.x + (out.x-in.x)*(dnll-in.dnll)/(out.dnll-in.dnll);
+  };
+  for (size_t i=m; i>0; --i)
+    if (points[i-1].dnll >= dnll) {
+      x.first = cross(points[i],points[i-1]);
+      break;
+    }
+  for (size_t i=m+1; i<points.size(); ++i)
+    if (points[i].dnll >= dnll) {
+      x.second = cross(points[i-1],points[i]);
+      break;
+    }
+  return x;
+}
+
+TGraph* profile_scan::graph() const {
+  TGraph *g = new TGraph(points.size());
+  for (size_t i=0; i<points.size(); ++i)
+    g->SetPoint(i,points[i].x,points[i].dnll);
+  g->SetName(cat("dnll_",par).c_str());
+  g->SetTitle(cat(";",par,";#DeltaNLL").c_str());
+  return g;
+}
+
+profile_scan run_profile_scan(
+  workspace& ws, TH1* hist, const string& par,
+  const profile_options& popt, unsigned njobs
+) {
+  RooRealVar *var = ws->var(par.c_str());
+  if (!var) throw runtime_error("no variable "+par+" in workspace");
+  if (var->isConstant() || !ws.depends_on(par.c_str()))
+    throw runtime_error("cannot profile "+par+", it is not fitted");
+
+  const auto init = ws.save();
+
+  fit_options opt;
+  opt.curve = false;
+  opt.verbose = false;
+  if (njobs > 1) opt.ncpu = 1;
+
+  // Unconstrained fit, the start of every chain
+  profile_scan scan { par, { }, { } };
+  int best_status;
+  {
+    auto fit = ws.fit(hist,opt);
+    best_status = fit.first->status();
+    scan.best = { var->getVal(), var->getError() };
+  }
+  const double best_nll = ws.nll(hist);
+  const auto best = ws.save();
+
+  // Grid, within the range of the parameter
+  double lo = scan.best.val - popt.nsigma*scan.best.err,
+         hi = scan.best.val + popt.nsigma*scan.best.err;
+  for (double x : popt.include) {
+    if (x < lo) lo = x;
+    if (x > hi) hi = x;
+  }
+  lo = max(lo,var->getMin());
+  hi = min(hi,var->getMax());
+  const unsigned n = popt.npoints;
+  vector<double> below, above; // outwards from the best fit
+  for (unsigned i=0; i<n; ++i) {
+    const double x = n > 1 ? lo + (hi-lo)*i/(n-1) : 0.5*(lo+hi);
+    (x < scan.best.val ? below : above).push_back(x);
+  }
+  reverse(below.begin(),below.end());
+
+  // Chains, alternating sides, so that the points
+  // near the minimum are spread over all workers
+  const size_t nside = max(1u,njobs/2);
+  vector<vector<double>> chains;
+  auto split = [nside](const vector<double>& side){
+    vector<vector<double>> cs;
+    const size_t nc = min(nside,side.size());
+    for (size_t c=0; c<nc; ++c)
+      cs.emplace_back(side.begin()+side.size()*c/nc,
+                      side.begin()+side.size()*(c+1)/nc);
+    return cs;
+  };
+  {
+    const auto b = split(below), a = split(above);
+    for (size_t c=0; c<max(b.size(),a.size()); ++c) {
+      if (c < b.size()) chains.push_back(b[c]);
+      if (c < a.size()) chains.push_back(a[c]);
+    }
+  }
+
+  cout << "Profile of " << par << ": " << n << " points in ["
+       << lo << ',' << hi << "], " << chains.size() << " chains" << endl;
+
+  // A chain is sent back as flat doubles: x, nll, status of every point
+  const auto flats = fork_map(chains.size(), njobs, [&](size_t c){
+    ws.restore(best);
+    vector<double> flat;
+    for (double x : chains[c]) {
+      ws.fixVal(par.c_str(),x);
+      auto fit = ws.fit(hist,opt);
+      flat.push_back(x);
+      flat.push_back(ws.nll(hist));
+      flat.push_back(fit.first->status());
+    }
+    return string(reinterpret_cast<const char*>(flat.data()),
+                  flat.size()*sizeof(double));
+  });
+
+  ws.restore(init); // leave the workspace as it was
+
+  scan.points.push_back({scan.best.val, best_nll, best_status});
+  for (const auto& f : flats) {
+    const double *flat = reinterpret_cast<const double*>(f.data());
+    for (size_t i=0, nf=f.size()/sizeof(double); i<nf; i+=3)
+      scan.points.push_back({flat[i], flat[i+1], int(flat[i+2])});
+  }
+  sort(scan.points.begin(),scan.points.end(),
+    [](const profile_point& a, const profile_point& b){ return a.x < b.x; });
+
+  double min_nll = best_nll;
+  for (const auto& p : scan.points) min_nll = min(min_nll,p.dnll);
+  for (auto& p : scan.points) p.dnll -= min_nll;
+
+  return scan;
+}
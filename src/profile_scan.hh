@@ -0,0 +1,52 @@
+#ifndef profile_scan_hh
+#define profile_scan_hh
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "val_err.hh"
+#include "workspace.hh"
+#include "fork_pool.hh"
+
+class TH1;
+class TGraph;
+
+struct profile_point {
+  double x, dnll;
+  int status; // of the fit at this point
+};
+
+struct profile_scan {
+  std::string par;
+  val_err<double> best; // unconstrained fit
+  std::vector<profile_point> points; // in increasing x, including best
+
+  // x where the linearly interpolated curve first crosses dnll
+  // below and above the minimum, NaN if it doesn't
+  std::pair<double,double> crossings(double dnll = 0.5) const;
+
+  TGraph* graph() const; // of dnll vs x
+};
+
+struct profile_options {
+  unsigned npoints = 20;  // not counting the unconstrained fit
+  double nsigma = 3.;     // grid half width, in errors of the best fit
+  std::vector<double> include; // values the grid is widened to contain
+};
+
+// Profile likelihood of hist in the workspace parameter par.
+// The parameter is fitted first, then fixed at every point of a
+// uniform grid around the best fit, with the others refitted.
+// Points on each side of the minimum are split into chains, each
+// fitted outwards by one worker, every point starting from the
+// solution of its inner neighbour and the first from the best fit.
+// dnll is relative to the lowest NLL found, with the NLL of
+// workspace::nll, scaled to the effective number of events,
+// so that dnll = 0.5 crossings bound 1 sigma intervals.
+// The workspace is left as it was.
+profile_scan run_profile_scan(
+  workspace& ws, TH1* hist, const std::string& par,
+  const profile_options& popt, unsigned njobs);
+
+#endif
@@ -0,0 +1,299 @@
+#include "results.hh"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+
+namespace {
+
+constexpr char pesr_magic[4] = {'P','E','S','R'};
+constexpr uint32_t pesr_version = 1;
+
+inline bool ends_with(const std::string& str, const char* suffix) {
+  const size_t n = std::strlen(suffix);
+  return str.size() >= n && !str.compare(str.size()-n,n,suffix);
+}
+
+void write_json_str(std::ostream& out, const std::string& str) {
+  out << '\"';
+  for (char c : str) {
+    switch (c) {
+      case '\"': out << "\\\""; break;
+      case '\\': out << "\\\\"; break;
+      case '\n': out << "\\n"; break;
+      case '\t': out << "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) { // other control characters
+          char esc[7];
+          snprintf(esc,sizeof(esc),"\\u%04x",c);
+          out << esc;
+        } else out << c;
+    }
+  }
+  out << '\"';
+}
+
+void write_json_num(std::ostream& out, double x) {
+  if (std::isfinite(x)) out << x;
+  else out << "null";
+}
+
+template<typename T>
+inline void write_pod(std::ostream& out, const T& x) {
+  out.write(reinterpret_cast<const char*>(&x),sizeof(T));
+}
+template<typename T>
+inline void write_col(std::ostream& out, const std::vector<T>& v) {
+  out.write(reinterpret_cast<const char*>(v.data()),v.size()*sizeof(T));
+}
+
+template<typename T>
+inline bool read_pod(std::istream& in, T& x) {
+  return bool(in.read(reinterpret_cast<char*>(&x),sizeof(T)));
+}
+template<typename T>
+inline void read_col(std::istream& in, std::vector<T>& v, size_t n) {
+  v.resize(n);
+  if (!in.read(reinterpret_cast<char*>(v.data()),n*sizeof(T)))
+    throw std::runtime_error("truncated results block");
+}
+
+// Minimal parser for the flat objects written by ndjson_writer
+class json_line {
+  const std::string& line;
+  size_t i;
+
+  void skip() { while (i<line.size() && isspace(line[i])) ++i; }
+  void expect(char c) {
+    skip();
+    if (i>=line.size() || line[i]!=c) throw std::runtime_error(
+      std::string("expected \'")+c+"\' in \""+line+'\"');
+    ++i;
+  }
+
+public:
+  json_line(const std::string& line): line(line), i(0) { }
+
+  std::string str() {
+    expect('\"');
+    std::string s;
+    for (; i<line.size() && line[i]!='\"'; ++i) {
+      if (line[i]=='\\' && ++i<line.size()) {
+        switch (line[i]) {
+          case 'n': s += '\n'; break;
+          case 't': s += '\t'; break;
+          default : s += line[i];
+        }
+      } else s += line[i];
+    }
+    expect('\"');
+    return s;
+  }
+
+  double num() {
+    skip();
+    if (!line.compare(i,4,"null")) {
+      i += 4;
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    size_t n;
+    const double x = std::stod(line.substr(i),&n);
+    i += n;
+    return x;
+  }
+
+  result parse() {
+    result r { {}, {}, {}, 0., 0. };
+    expect('{');
+    for (bool first=true; ; first=false) {
+      skip();
+      if (i<line.size() && line[i]=='}') break;
+      if (!first) expect(',');
+      const std::string key = str();
+      expect(':');
+      if (key=="variation") r.variation = str();
+      else if (key=="name") r.name = str();
+      else if (key=="stage") r.stage = str();
+      else if (key=="value") r.val = num();
+      else if (key=="error") r.err = num();
+      else throw std::runtime_error("unexpected key \""+key+'\"');
+    }
+    return r;
+  }
+};
+
+void read_ndjson(std::istream& in, std::vector<result>& results,
+                 const std::unordered_set<std::string>& names) {
+  std::string line;
+  while (std::getline(in,line)) {
+    if (line.empty()) continue;
+    result r = json_line(line).parse();
+    if (names.empty() || names.count(r.name))
+      results.emplace_back(std::move(r));
+  }
+}
+
+void read_binary(std::istream& in, std::vector<result>& results,
+                 const std::unordered_set<std::string>& names) {
+  uint32_t version;
+  if (!read_pod(in,version) || version!=pesr_version)
+    throw std::runtime_error("unsupported results format version");
+
+  std::vector<std::string> dict;
+  std::vector<bool> wanted; // by name id
+  std::vector<uint16_t> variation, name, stage;
+  std::vector<double> val, err;
+
+  for (uint32_t nstr; read_pod(in,nstr); ) {
+    for (uint32_t k=0; k<nstr; ++k) {
+      uint16_t len;
+      read_pod(in,len);
+      std::string str(len,'\0');
+      in.read(&str[0],len);
+      wanted.push_back(names.empty() || names.count(str));
+      dict.emplace_back(std::move(str));
+    }
+    uint32_t n;
+    if (!read_pod(in,n)) throw std::runtime_error("truncated results block");
+    read_col(in,variation,n);
+    read_col(in,name,n);
+    read_col(in,stage,n);
+    read_col(in,val,n);
+    read_col(in,err,n);
+    for (uint32_t k=0; k<n; ++k)
+      if (wanted.at(name[k])) results.push_back({
+        dict.at(variation[k]), dict[name[k]], dict.at(stage[k]),
+        val[k], err[k]
+      });
+  }
+}
+
+}
+
+// NDJSON ***********************************************************
+
+ndjson_writer::ndjson_writer(const std::string& fname)
+: out(new std::ofstream(fname))
+{
+  if (!*out) throw std::runtime_error("Cannot open "+fname);
+  *out << std::setprecision(std::numeric_limits<double>::max_digits10);
+}
+
+void ndjson_writer::write(
+  const std::string& variation, const std::string& name,
+  double val, double err, const char* stage
+) {
+  *out << "{\"variation\":";
+  write_json_str(*out,variation);
+  *out << ",\"name\":";
+  write_json_str(*out,name);
+  *out << ",\"value\":";
+  write_json_num(*out,val);
+  *out << ",\"error\":";
+  write_json_num(*out,err);
+  *out << ",\"stage\":";
+  write_json_str(*out,stage);
+  *out << "}\n";
+  out->flush();
+}
+
+void ndjson_writer::flush() { out->flush(); }
+
+// Binary ***********************************************************
+
+binary_writer::binary_writer(const std::string& fname, size_t block_size)
+: out(new std::ofstream(fname,std::ios::binary)), block_size(block_size)
+{
+  if (!*out) throw std::runtime_error("Cannot open "+fname);
+  out->write(pesr_magic,sizeof(pesr_magic));
+  write_pod(*out,pesr_version);
+}
+
+binary_writer::~binary_writer() { flush(); }
+
+uint16_t binary_writer::id(const std::string& str) {
+  for (size_t i=dict.size(); i; --i)
+    if (dict[i-1]==str) return i-1;
+  if (dict.size() > std::numeric_limits<uint16_t>::max())
+    throw std::runtime_error("too many distinct strings in results");
+  if (str.size() > std::numeric_limits<uint16_t>::max())
+    throw std::runtime_error("string too long for results: "+str);
+  dict.push_back(str);
+  new_strings.push_back(str);
+  return dict.size()-1;
+}
+
+void binary_writer::write(
+  const std::string& variation, const std::string& name,
+  double val, double err, const char* stage
+) {
+  this->variation.push_back(id(variation));
+  this->name.push_back(id(name));
+  this->stage.push_back(id(stage));
+  this->val.push_back(val);
+  this->err.push_back(err);
+  if (this->val.size() >= block_size) flush();
+}
+
+void binary_writer::flush() {
+  if (val.empty()) return;
+  write_pod(*out,uint32_t(new_strings.size()));
+  for (const auto& str : new_strings) {
+    write_pod(*out,uint16_t(str.size()));
+    out->write(str.data(),str.size());
+  }
+  write_pod(*out,uint32_t(val.size()));
+  write_col(*out,variation);
+  write_col(*out,name);
+  write_col(*out,stage);
+  write_col(*out,val);
+  write_col(*out,err);
+  out->flush();
+
+  new_strings.clear();
+  variation.clear();
+  name.clear();
+  stage.clear();
+  val.clear();
+  err.clear();
+}
+
+// ******************************************************************
+
+std::unique_ptr<results_writer> make_results_writer(const std::string& fname)
+{
+  if (ends_with(fname,".ndjson"))
+    return std::unique_ptr<results_writer>(new ndjson_writer(fname));
+  else if (ends_with(fname,".pesr"))
+    return std::unique_ptr<results_writer>(new binary_writer(fname));
+  else throw std::runtime_error(
+    "Results file "+fname+" is not .ndjson or .pesr");
+}
+
+std::vector<result> read_results(const std::string& fname,
+  const std::unordered_set<std::string>& names
+) {
+  std::ifstream in(fname,std::ios::binary);
+  if (!in) throw std::runtime_error("Cannot open "+fname);
+
+  std::vector<result> results;
+  char magic[sizeof(pesr_magic)] = { };
+  in.read(magic,sizeof(magic));
+  try {
+    if (in && !std::memcmp(magic,pesr_magic,sizeof(magic))) {
+      read_binary(in,results,names);
+    } else {
+      in.clear();
+      in.seekg(0);
+      read_ndjson(in,results,names);
+    }
+  } catch (const std::exception& e) {
+    throw std::runtime_error(fname+": "+e.what());
+  }
+  return results;
+}
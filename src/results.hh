@@ -0,0 +1,79 @@
+#ifndef results_hh
+#define results_hh
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <memory>
+#include <iosfwd>
+#include <cstdint>
+
+// A single computed quantity, e.g. ("nominal","mean_offset_bin0",v,e,"fit")
+struct result {
+  std::string variation, name, stage;
+  double val, err;
+};
+
+// Streams results as they are computed
+class results_writer {
+public:
+  virtual ~results_writer() { }
+  virtual void write(const std::string& variation, const std::string& name,
+                     double val, double err, const char* stage) = 0;
+  virtual void flush() = 0;
+};
+
+// One JSON object per line, flushed after every record
+class ndjson_writer: public results_writer {
+  std::unique_ptr<std::ostream> out;
+public:
+  ndjson_writer(const std::string& fname);
+  void write(const std::string& variation, const std::string& name,
+             double val, double err, const char* stage);
+  void flush();
+};
+
+// Binary column blocks.
+// Each block starts with the strings it introduces to the dictionary,
+// followed by the variation, name and stage ids and the value and
+// error columns of its records.
+class binary_writer: public results_writer {
+  std::unique_ptr<std::ostream> out;
+  std::vector<std::string> dict;
+  std::vector<std::string> new_strings;
+  std::vector<uint16_t> variation, name, stage;
+  std::vector<double> val, err;
+  size_t block_size;
+
+  uint16_t id(const std::string& str);
+
+public:
+  binary_writer(const std::string& fname, size_t block_size=256);
+  ~binary_writer();
+  void write(const std::string& variation, const std::string& name,
+             double val, double err, const char* stage);
+  void flush();
+};
+
+// Format is selected by file extension: .ndjson or .pesr
+std::unique_ptr<results_writer> make_results_writer(const std::string& fname);
+
+// Read results from either format,
+// keeping only the named quantities, or all if names is empty
+std::vector<result> read_results(const std::string& fname,
+  const std::unordered_set<std::string>& names = { });
+
+// Fill seqmap<structmap> stats, indexed as stats[name][variation]
+// Variations that are not fields of the structmap are skipped
+template<typename Stats>
+void fill_stats(Stats& stats, const std::vector<result>& results) {
+  using fields = typename Stats::mapped_type;
+  for (const auto& r : results) {
+    if (fields::_index(r.variation) < 0) continue;
+    auto& x = stats[r.name][r.variation];
+    x.val = r.val;
+    x.err = r.err;
+  }
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "run_report.hh"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "seqmap.hh"
+
+using namespace std;
+
+namespace {
+
+const auto start_wall = chrono::steady_clock::now();
+const time_t start_time = time(nullptr);
+
+seqmap<stage_counters>& stages() {
+  static seqmap<stage_counters> s;
+  return s;
+}
+
+struct open_stage {
+  string name;
+  stage_counters *counters;
+};
+vector<open_stage>& open_stages() {
+  static vector<open_stage> s;
+  return s;
+}
+
+string report_fname, report_program;
+
+unsigned long long total_fcn_calls = 0;
+
+string json_str(const string& s) {
+  string out = "\"";
+  for (char c : s) {
+    if (c=='\"' || c=='\\') out += '\\';
+    if ((unsigned char)c < 0x20) out += ' ';
+    else out += c;
+  }
+  return out += '\"';
+}
+
+void write_report() {
+  ofstream f(report_fname);
+  if (!f) {
+    cerr << "\033[31mCannot write run report " << report_fname
+         << "\033[0m" << endl;
+    return;
+  }
+  f << setprecision(6)
+    << "{\n  \"program\": " << json_str(report_program)
+    << ",\n  \"pid\": " << getpid()
+    << ",\n  \"start\": " << start_time
+    << ",\n  \"wall\": " << chrono::duration<double>(
+         chrono::steady_clock::now()-start_wall).count()
+    << ",\n  \"cpu\": " << double(clock())/CLOCKS_PER_SEC
+    << ",\n  \"stages\": [";
+  bool first = true;
+  for (const auto& s : stages()) {
+    const stage_counters& c = s.second;
+    f << (first ? "" : ",") << "\n    { \"name\": " << json_str(s.first)
+      << ", \"calls\": " << c.calls
+      << ", \"wall\": " << c.wall
+      << ", \"cpu\": " << c.cpu
+      << ", \"bytes\": " << c.bytes
+      << ", \"events\": " << c.events
+      << ", \"fits\": " << c.fits
+      << ", \"fcn_calls\": " << c.fcn_calls << " }";
+    first = false;
+  }
+  f << "\n  ]\n}\n";
+}
+
+template<typename F>
+inline void for_open(F f) {
+  for (auto& s : open_stages()) f(*s.counters);
+}
+
+}
+
+timed_stage::timed_stage(const string& name) {
+  auto& open = open_stages();
+  const string full = open.empty() ? name : open.back().name+'/'+name;
+  counters = &stages()[full];
+  open.push_back({full,counters});
+  wall0 = chrono::steady_clock::now();
+  cpu0 = clock();
+}
+
+timed_stage::~timed_stage() {
+  counters->wall += chrono::duration<double>(
+    chrono::steady_clock::now()-wall0).count();
+  counters->cpu += double(clock()-cpu0)/CLOCKS_PER_SEC;
+  ++counters->calls;
+  open_stages().pop_back();
+}
+
+namespace run_report {
+
+void count_bytes(unsigned long long n) {
+  for_open([n](stage_counters& c){ c.bytes += n; });
+}
+void count_events(unsigned long long n) {
+  for_open([n](stage_counters& c){ c.events += n; });
+}
+void count_fits(unsigned long long n, unsigned long long fcn_calls) {
+  for_open([=](stage_counters& c){ c.fits += n; c.fcn_calls += fcn_calls; });
+  total_fcn_calls += fcn_calls;
+}
+
+unsigned long long fcn_calls() { return total_fcn_calls; }
+
+void write_at_exit(const string& fname, const string& program) {
+  stages(); // constructed before, so destroyed after the report is written
+  const bool registered = !report_fname.empty();
+  report_fname = fname;
+  report_program = program;
+  if (!registered) atexit(write_report);
+}
+
+void reset() {
+  for (auto& s : stages()) s.second = stage_counters();
+}
+
+string serialize() {
+  stringstream ss;
+  ss << setprecision(17);
+  for (const auto& s : stages()) {
+    const stage_counters& c = s.second;
+    if (!(c.calls || c.bytes || c.events || c.fits)) continue;
+    ss << s.first << '\t' << c.wall << ' ' << c.cpu << ' ' << c.calls << ' '
+       << c.bytes << ' ' << c.events << ' ' << c.fits << ' '
+       << c.fcn_calls << '\n';
+  }
+  return ss.str();
+}
+
+void merge(const string& str) {
+  stringstream ss(str);
+  string name;
+  stage_counters x;
+  while (getline(ss,name,'\t') &&
+         ss >> x.wall >> x.cpu >> x.calls >> x.bytes >> x.events
+            >> x.fits >> x.fcn_calls) {
+    ss.ignore();
+    stage_counters& c = stages()[name];
+    c.wall += x.wall;
+    c.cpu += x.cpu;
+    c.calls += x.calls;
+    c.bytes += x.bytes;
+    c.events += x.events;
+    c.fits += x.fits;
+    c.fcn_calls += x.fcn_calls;
+  }
+}
+
+}
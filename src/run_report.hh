@@ -0,0 +1,55 @@
+#ifndef run_report_hh
+#define run_report_hh
+
+#include <string>
+#include <chrono>
+#include <ctime>
+
+// Wall and CPU time and counters of the stages of a run,
+// written as a JSON report when the program exits.
+// Stages nest: a stage opened inside another is named "outer/inner".
+// Counters are added to every open stage, so outer stages include
+// everything done inside them, like their times do.
+// Stages run in fork_map workers are sent back to the parent.
+struct stage_counters {
+  double wall = 0., cpu = 0.; // seconds
+  unsigned long long calls = 0, bytes = 0, events = 0,
+                     fits = 0, fcn_calls = 0;
+};
+
+// Times the scope it lives in as a stage
+class timed_stage {
+  stage_counters *counters;
+  std::chrono::steady_clock::time_point wall0;
+  std::clock_t cpu0;
+
+public:
+  explicit timed_stage(const std::string& name);
+  ~timed_stage();
+  timed_stage(const timed_stage&) = delete;
+  timed_stage& operator=(const timed_stage&) = delete;
+};
+
+namespace run_report {
+
+// Add to the counters of all open stages
+void count_bytes(unsigned long long n);
+void count_events(unsigned long long n);
+void count_fits(unsigned long long n, unsigned long long fcn_calls);
+
+// Likelihood evaluations counted by this process so far,
+// in or out of stages
+unsigned long long fcn_calls();
+
+// Write the report to fname at exit, program names the run
+void write_at_exit(const std::string& fname, const std::string& program);
+
+// Zero the counters, serialize the ones recorded since,
+// and add serialized counters, to collect stages from workers
+void reset();
+std::string serialize();
+void merge(const std::string& str);
+
+}
+
+#endif
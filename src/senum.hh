@@ -5,6 +5,7 @@
 #include <iostream>
 #include <string>
 #include <stdexcept>
+#include "string_view.hh"
 #endif
 
 #include <boost/preprocessor/cat.hpp>
@@ -18,8 +19,10 @@
 #define SENUM_EN_CASE(r, data, elem) \
   case elem: return BOOST_PP_STRINGIZE(elem);
 
+// dispatch on FNV-1a hash, colliding values fail to compile as duplicate cases
 #define SENUM_STR_CASE(r, enum_name, elem) \
-  if (!str.compare( BOOST_PP_STRINGIZE(elem) )) return elem; else
+  case fnv1a(BOOST_PP_STRINGIZE(elem), sizeof(BOOST_PP_STRINGIZE(elem))-1): \
+    if (str == BOOST_PP_STRINGIZE(elem)) return elem; else break;
 
 #define SENUM_CS(r, enum_name, elem) BOOST_PP_IF(BOOST_PP_GREATER(r,2),", ",) BOOST_PP_STRINGIZE(elem)
 
@@ -27,10 +30,13 @@
   struct enum_name { \
     enum type { BOOST_PP_SEQ_ENUM(values) }; \
     enum { _nelem = BOOST_PP_SEQ_SIZE(values) }; \
-    static type _enum(const std::string& str) { \
-      BOOST_PP_SEQ_FOR_EACH( SENUM_STR_CASE, nil, values ) \
+    static type _enum(string_view str) { \
+      switch (fnv1a(str.data(),str.size())) { \
+        BOOST_PP_SEQ_FOR_EACH( SENUM_STR_CASE, nil, values ) \
+      } \
       throw std::runtime_error( \
-        "invalid value \""+str+"\" specified for stringized enum " \
+        "invalid value \""+std::string(str.data(),str.size())+ \
+        "\" specified for stringized enum " \
         BOOST_PP_STRINGIZE(enum_name) \
       ); \
     } \
@@ -1,22 +1,109 @@
 #ifndef seqmap_hh
 #define seqmap_hh
 
-#include <vector>
+#include <deque>
 #include <string>
 #include <utility>
-#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
 
+#include "string_view.hh"
+#include "catstr.hh"
+
+template<typename Key> struct seqmap_key {
+  using view = Key;
+  using hash = std::hash<Key>;
+  static std::string str(const view& key) { return cat(key); }
+};
+template<> struct seqmap_key<std::string> {
+  using view = string_view; // lookup without temporary strings
+  using hash = string_view_hash;
+  static std::string str(view key) { return {key.data(),key.size()}; }
+};
+
+// Map that iterates in insertion order.
+// Values are stored in a deque, so references stay valid
+// as elements are added. Lookup is hashed.
 template<typename T, typename Key=std::string>
-class seqmap: public std::vector<std::pair<Key,T>> {
+class seqmap {
 public:
-  T& operator[](const Key& key) {
-    auto it = std::find_if(this->begin(),this->end(),
-      [&key](const std::pair<Key,T>& p){ return p.first==key; });
-    if (it==this->end()) {
-      this->emplace_back(key,T());
-      return this->back().second;
-    } else return it->second;
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key,T>;
+  using key_view = typename seqmap_key<Key>::view;
+
+private:
+  using store_t = std::deque<value_type>;
+  store_t store;
+  // views of the keys in store
+  std::unordered_map<key_view,size_t,typename seqmap_key<Key>::hash> index;
+
+  void reindex() {
+    index.clear();
+    index.reserve(store.size());
+    for (size_t i=0; i<store.size(); ++i)
+      index.emplace(key_view(store[i].first),i);
+  }
+
+public:
+  using iterator = typename store_t::iterator;
+  using const_iterator = typename store_t::const_iterator;
+
+  seqmap() = default;
+  seqmap(const seqmap& o): store(o.store) { reindex(); }
+  seqmap(seqmap&&) = default; // deque nodes don't move
+  seqmap& operator=(const seqmap& o) {
+    if (this!=&o) { store = o.store; reindex(); }
+    return *this;
+  }
+  seqmap& operator=(seqmap&&) = default;
+
+  T& operator[](key_view key) {
+    auto it = index.find(key);
+    if (it!=index.end()) return store[it->second].second;
+    store.emplace_back(Key(key),T());
+    index.emplace(key_view(store.back().first),store.size()-1);
+    return store.back().second;
+  }
+
+  iterator find(key_view key) {
+    auto it = index.find(key);
+    return it==index.end() ? store.end() : store.begin()+it->second;
+  }
+  const_iterator find(key_view key) const {
+    auto it = index.find(key);
+    return it==index.end() ? store.end() : store.begin()+it->second;
+  }
+  size_t count(key_view key) const { return index.count(key); }
+
+  T& at(key_view key) {
+    auto it = find(key);
+    if (it==end()) throw std::out_of_range(
+      "seqmap: no key \""+seqmap_key<Key>::str(key)+'\"');
+    return it->second;
   }
+  const T& at(key_view key) const {
+    auto it = find(key);
+    if (it==end()) throw std::out_of_range(
+      "seqmap: no key \""+seqmap_key<Key>::str(key)+'\"');
+    return it->second;
+  }
+
+  void reserve(size_t n) { index.reserve(n); }
+  void clear() { store.clear(); index.clear(); }
+
+  size_t size() const noexcept { return store.size(); }
+  bool empty() const noexcept { return store.empty(); }
+
+  iterator begin() noexcept { return store.begin(); }
+  iterator end() noexcept { return store.end(); }
+  const_iterator begin() const noexcept { return store.begin(); }
+  const_iterator end() const noexcept { return store.end(); }
+
+  value_type& front() { return store.front(); }
+  value_type& back() { return store.back(); }
+  const value_type& front() const { return store.front(); }
+  const value_type& back() const { return store.back(); }
 };
 
 #endif
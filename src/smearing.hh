@@ -0,0 +1,46 @@
+#ifndef smearing_hh
+#define smearing_hh
+
+#include <string>
+#include <vector>
+
+#include "events.hh"
+
+class TH1;
+
+// Variations of one systematic at any magnitude a, in units of its
+// stored 1 sigma variations, derived per event from the nominal m_yy
+// and the down and up m_yy: m_yy(a) = nominal + a*(up - nominal)
+// for a > 0 and nominal + a*(nominal - down) for a < 0.
+// a = -1, 0, 1 give the stored down, nominal and up values,
+// other values interpolate or extrapolate the shift, for scale
+// systematics, or the extra smearing, for resolution systematics,
+// of every event linearly.
+class smearing_engine {
+  const event_store& events;
+  std::string group;
+  size_t nominal, down, up; // variation indices
+
+  template <typename Fill>
+  void pass(const std::vector<double>& magnitudes, Fill fill) const;
+
+public:
+  // group is the name of the systematic's variations without
+  // _down or _up, e.g. scale or res
+  smearing_engine(const event_store& events, const std::string& group);
+
+  // Groups of the store with both down and up variations
+  static std::vector<std::string> groups(const event_store& events);
+
+  // Histogram name of the systematic at magnitude a, e.g. scale_m0.5
+  std::string name(double a) const;
+
+  // d(sigma)/dm_yy histograms at each magnitude, not owned by any
+  // directory, filled in one pass over the events
+  std::vector<TH1*> hists(const std::vector<double>& magnitudes,
+    int nbins, double xmin, double xmax) const;
+  std::vector<TH1*> hists(const std::vector<double>& magnitudes,
+    const std::vector<double>& edges) const;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef string_view_hh
+#define string_view_hh
+
+#include <cstddef>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+using std::string_view;
+#else
+#include <boost/utility/string_view.hpp>
+using boost::string_view;
+#endif
+
+// 64-bit FNV-1a, usable in constant expressions
+constexpr unsigned long long fnv1a(
+  const char* s, std::size_t n,
+  unsigned long long h = 14695981039346656037ull
+) noexcept {
+  return n ? fnv1a(s+1, n-1, (h ^ (unsigned char)*s) * 1099511628211ull) : h;
+}
+
+struct string_view_hash {
+  std::size_t operator()(string_view s) const noexcept {
+    return fnv1a(s.data(),s.size());
+  }
+};
+
+#endif
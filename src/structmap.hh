@@ -5,23 +5,59 @@
 #include <iostream>
 #include <string>
 #include <stdexcept>
+#include "string_view.hh"
 #endif
 
 #include <boost/preprocessor/stringize.hpp>
+#include <boost/preprocessor/seq/size.hpp>
 #include <boost/preprocessor/seq/enum.hpp>
 #include <boost/preprocessor/seq/for_each.hpp>
 
-#define STRUCTMAP_STR_CASE(r, enum_name, elem) \
-  if (!str.compare( BOOST_PP_STRINGIZE(elem) )) return elem; else
+// Field names are dispatched by their FNV-1a hash,
+// a hash collision between two fields is a duplicate case compile error
+#define STRUCTMAP_HASH(elem) \
+  fnv1a(BOOST_PP_STRINGIZE(elem), sizeof(BOOST_PP_STRINGIZE(elem))-1)
 
-#define structmap(type, map_name, values) \
+#define STRUCTMAP_STR_CASE(r, data, elem) \
+  case STRUCTMAP_HASH(elem): \
+    if (str == BOOST_PP_STRINGIZE(elem)) return _idx::elem; else break;
+
+#define STRUCTMAP_IDX_CASE(r, data, elem) \
+  case _idx::elem: return elem;
+
+#define STRUCTMAP_NAME(r, data, elem) \
+  i==_idx::elem ? BOOST_PP_STRINGIZE(elem) :
+
+// _idx::type enumerates the fields in order,
+// x[map_name::_idx::field] is resolved at compile time
+#define structmap(field_type, map_name, values) \
   struct map_name { \
-    type BOOST_PP_SEQ_ENUM(values); \
-    type& operator[](const std::string& str) { \
-      BOOST_PP_SEQ_FOR_EACH( STRUCTMAP_STR_CASE, nil, values ) \
+    field_type BOOST_PP_SEQ_ENUM(values); \
+    struct _idx { enum type { BOOST_PP_SEQ_ENUM(values) }; }; \
+    enum { _size = BOOST_PP_SEQ_SIZE(values) }; \
+    static constexpr const char* _name(int i) noexcept { \
+      return BOOST_PP_SEQ_FOR_EACH( STRUCTMAP_NAME, nil, values ) nullptr; \
+    } \
+    field_type& operator[](_idx::type i) { \
+      switch (i) { \
+        BOOST_PP_SEQ_FOR_EACH( STRUCTMAP_IDX_CASE, nil, values ) \
+      } \
+      throw std::out_of_range( \
+        "structmap " BOOST_PP_STRINGIZE(map_name) " index out of range"); \
+    } \
+    /* field index, -1 if there is no such field */ \
+    static int _index(string_view str) noexcept { \
+      switch (fnv1a(str.data(),str.size())) { \
+        BOOST_PP_SEQ_FOR_EACH( STRUCTMAP_STR_CASE, nil, values ) \
+      } \
+      return -1; \
+    } \
+    field_type& operator[](string_view str) { \
+      const int i = _index(str); \
+      if (i >= 0) return (*this)[_idx::type(i)]; \
       throw std::runtime_error( \
         "structmap " BOOST_PP_STRINGIZE(map_name) \
-        " does not map \""+str+"\"" \
+        " does not map \""+std::string(str.data(),str.size())+"\"" \
       ); \
     } \
   }
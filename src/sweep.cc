@@ -0,0 +1,320 @@
+// Fit a grid of histogramming and fit settings
+// with a single read of the input files.
+// Variations at other magnitudes than the stored 1 sigma ones
+// are interpolated from them, see smearing.hh.
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/program_options.hpp>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TGraph.h>
+
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooFitResult.h>
+#include <RooMsgService.h>
+
+#include "catstr.hh"
+#include "val_err.hh"
+#include "TGraph_fcns.hh"
+#include "root_safe_get.hh"
+#include "workspace.hh"
+#include "window_mean.hh"
+#include "fork_pool.hh"
+#include "events.hh"
+#include "inputs.hh"
+#include "text_num.hh"
+#include "adaptive_binning.hh"
+#include "smearing.hh"
+
+using namespace std;
+namespace po = boost::program_options;
+
+#define test(var) \
+  std::cout <<"\033[36m"<< #var <<"\033[0m"<< " = " << var << std::endl;
+
+namespace std {
+  template <typename T1, typename T2>
+  istream& operator>>(istream& in, pair<T1,T2>& p) {
+    string s;
+    in >> s;
+    size_t sep = s.find(':');
+    if (sep==string::npos) throw invalid_argument(
+      cat('\"',s,"\": pair values must be delimited by \':\'"));
+    stringstream (s.substr(0,sep)) >> p.first;
+    stringstream (s.substr(sep+1)) >> p.second;
+    return in;
+  }
+}
+
+using ws_ranges = vector<pair<string,pair<double,double>>>;
+
+// "name:min:max,name:min:max" or "none"
+ws_ranges parse_ranges(const string& str) {
+  ws_ranges ranges;
+  if (str=="none") return ranges;
+  stringstream ss(str);
+  string range;
+  while (getline(ss,range,',')) {
+    ranges.emplace_back();
+    stringstream(range) >> ranges.back();
+  }
+  return ranges;
+}
+
+// One set of settings
+struct point {
+  int nbins;
+  pair<double,double> xrange;
+  double precision; // adaptive binning of the nbins, 0 for uniform
+  string ws_range;
+  bool fix_alpha;
+};
+
+int main(int argc, char** argv)
+{
+  vector<string> ifname;
+  string ofname, wfname, cfname, syst_re;
+  vector<int> nbins;
+  vector<pair<double,double>> xranges;
+  vector<double> precisions, magnitudes;
+  vector<string> ranges;
+  vector<bool> fix_alpha;
+  unsigned njobs;
+
+  // options ---------------------------------------------------
+  try {
+    po::options_description desc("Options");
+    desc.add_options()
+      ("input,i", po::value(&ifname)->multitoken()->required(),
+       "*input root file names")
+      ("output,o", po::value(&ofname)->required(),
+       "*output root file name")
+      ("workspace,w", po::value(&wfname)->default_value("data/ws.root"),
+       "ROOT file with RooWorkspace for CB fits")
+      ("config,c", po::value(&cfname),
+       "configuration file name")
+      ("syst,s",
+       po::value(&syst_re)->default_value("EG_(SCALE|RESOLUTION)_ALL"),
+       "regex of systematics with m_yy variations, \".*\" for all")
+
+      ("nbins,n", po::value(&nbins)->multitoken()->
+        default_value({100},"100"),
+       "grid of histograms\' number of bins")
+      ("xrange,x", po::value(&xranges)->multitoken()->
+        default_value({{105,140}},"105:140"),
+       "grid of histograms\' X ranges")
+      ("precision,p", po::value(&precisions)->multitoken()->
+        default_value({0},"0"),
+       "grid of adaptive binning relative precisions, 0 for uniform;\n"
+       "nbins bins are merged until every bin's relative uncertainty\n"
+       "in the nominal histogram is at most this")
+      ("ws-setRange", po::value(&ranges)->multitoken()->
+        default_value({"none"},"none"),
+       "grid of RooWorkspace::setRange() calls,\n"
+       "each name:min:max[,name:min:max...] or none")
+      ("fix-alpha", po::value(&fix_alpha)->multitoken()->
+        default_value({false},"0"),
+       "grid of fixing crys_alpha_bin0 after nominal fit, 0 or 1")
+      ("magnitudes,a", po::value(&magnitudes)->multitoken(),
+       "also fit every systematic with down and up variations\n"
+       "at these magnitudes, in units of its 1 sigma variations")
+      ("jobs,j", po::value(&njobs)->default_value(4),
+       "number of worker processes fitting grid points")
+    ;
+
+    po::positional_options_description pos;
+    pos.add("input",-1);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv)
+      .options(desc).positional(pos).run(), vm);
+    if (argc == 1) {
+      cout << desc << endl;
+      return 0;
+    }
+    if (vm.count("config")) {
+      po::store( po::parse_config_file<char>(
+        vm["config"].as<string>().c_str(), desc), vm);
+    }
+    po::notify(vm);
+
+    for (const auto& r : ranges) parse_ranges(r);
+  } catch (std::exception& e) {
+    cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
+    return 1;
+  }
+  // end options ---------------------------------------------------
+
+  vector<point> points;
+  for (int n : nbins)
+    for (const auto& x : xranges)
+      for (double prec : precisions)
+        for (const auto& r : ranges)
+          for (bool a : fix_alpha)
+            points.push_back({n,x,prec,r,a});
+
+  // Read events once ***********************************************
+  unique_ptr<event_store> events;
+  for (const string& f : ifname) {
+    TFile *file = new TFile(f.c_str(),"read");
+    if (file->IsZombie()) return 1;
+    cout << "Data file: " << f << endl;
+    TTree *tree = get<TTree>(file,"CollectionTree");
+
+    const double xsecscale = cutflow_scale(file,f);
+    static process_set procs;
+    procs.add(f,file_process(f));
+
+    if (!events) events.reset(new event_store(find_variations(tree,syst_re)));
+    events->read(tree,xsecscale);
+
+    delete file;
+  }
+  const auto& vars = events->variations();
+  vector<smearing_engine> smearings;
+  if (!magnitudes.empty())
+    for (const auto& group : smearing_engine::groups(*events))
+      smearings.emplace_back(*events,group);
+  cout << events->size() << " events, "
+       << vars.size() << " variations, "
+       << smearings.size()*magnitudes.size() << " interpolated, "
+       << points.size() << " grid points" << endl;
+
+  // Fit grid points ************************************************
+  workspace ws(wfname);
+  // restored before every grid point,
+  // because ranges are changed by --ws-setRange and --fix-alpha
+  const auto init = ws.save();
+
+  auto& msg = RooMsgService::instance();
+  msg.setGlobalKillBelow(RooFit::ERROR);
+
+  fit_options opt;
+  opt.verbose = false;
+  opt.ncpu = 1;
+
+  // Records are sent back from the workers as lines of
+  // variation, name, val, err
+  const auto out = fork_map(points.size(), njobs, [&](size_t p){
+    ws.restore(init);
+    const point& pt = points[p];
+    for (const auto& r : parse_ranges(pt.ws_range))
+      ws.setRange(r.first.c_str(),r.second.first,r.second.second);
+
+    stringstream ss;
+    ss << setprecision(17);
+    auto rec = [&ss](const string& var, const char* name,
+                     const val_err<double>& x){
+      ss << var << '\t' << name << '\t'
+         << put_num(x.val) << '\t' << put_num(x.err) << '\n';
+    };
+
+    // bins are derived from the nominal variation, the first one
+    vector<double> edges;
+    if (pt.precision > 0) {
+      unique_ptr<TH1> fine(
+        events->hist(0,pt.nbins,pt.xrange.first,pt.xrange.second));
+      edges = adaptive_edges(fine.get(),pt.precision);
+      rec("nominal","nbins_adaptive",double(edges.size()-1));
+    }
+
+    auto fit_hist = [&](TH1* h){
+      if (!h->GetEntries()) return;
+      const string name = h->GetName();
+
+      rec(name,"hist_N",h->GetEntries());
+      rec(name,"hist_mean",{h->GetMean(),h->GetMeanError()});
+      rec(name,"hist_stdev",{h->GetStdDev(),h->GetStdDevError()});
+      rec(name,"hist_window_mean",window_mean(h,120,130));
+
+      auto fit = ws.fit(h,opt);
+      for (const char* par : cb_pars) {
+        auto *var = static_cast<RooRealVar*>(
+          fit.first->floatParsFinal().find(par));
+        rec(name,par,{var->getVal(),var->getError()});
+      }
+      rec(name,"FWHM",fwhm(fit.second));
+
+      if (pt.fix_alpha && name=="nominal") {
+        auto *alpha = ws->var("crys_alpha_bin0");
+        alpha->setRange(alpha->getVal(),alpha->getVal());
+      }
+    };
+
+    for (size_t i=0; i<vars.size(); ++i) {
+      unique_ptr<TH1> h(edges.empty()
+        ? events->hist(i,pt.nbins,pt.xrange.first,pt.xrange.second)
+        : events->hist(i,edges));
+      fit_hist(h.get());
+    }
+    for (const auto& smearing : smearings)
+      for (TH1 *h : edges.empty()
+          ? smearing.hists(magnitudes,pt.nbins,pt.xrange.first,pt.xrange.second)
+          : smearing.hists(magnitudes,edges)) {
+        fit_hist(h);
+        delete h;
+      }
+    return ss.str();
+  });
+
+  // Write the table ************************************************
+  TFile fout(ofname.c_str(),"recreate");
+  if (fout.IsZombie()) return 1;
+  TTree *tree = new TTree("sweep","sweep");
+
+  Int_t point_i, nbins_;
+  Double_t xmin, xmax, precision, val, err;
+  Bool_t fix_alpha_;
+  string ws_range, variation, name;
+  tree->Branch("point",&point_i,"point/I");
+  tree->Branch("nbins",&nbins_,"nbins/I");
+  tree->Branch("xmin",&xmin,"xmin/D");
+  tree->Branch("xmax",&xmax,"xmax/D");
+  tree->Branch("precision",&precision,"precision/D");
+  tree->Branch("ws_range",&ws_range);
+  tree->Branch("fix_alpha",&fix_alpha_,"fix_alpha/O");
+  tree->Branch("variation",&variation);
+  tree->Branch("name",&name);
+  tree->Branch("val",&val,"val/D");
+  tree->Branch("err",&err,"err/D");
+
+  for (size_t p=0; p<points.size(); ++p) {
+    const point& pt = points[p];
+    point_i = p;
+    nbins_ = pt.nbins;
+    xmin = pt.xrange.first;
+    xmax = pt.xrange.second;
+    precision = pt.precision;
+    ws_range = pt.ws_range;
+    fix_alpha_ = pt.fix_alpha;
+
+    cout << "Point " << p << ": nbins=" << nbins_
+         << " xrange=" << xmin << ':' << xmax
+         << " precision=" << precision
+         << " ws-setRange=" << ws_range
+         << " fix-alpha=" << fix_alpha_ << endl;
+
+    stringstream ss(out[p]);
+    while (getline(ss,variation,'\t') && getline(ss,name,'\t')) {
+      if (!(ss >> get_num(val) >> get_num(err))) throw runtime_error(cat(
+        "Bad record ",variation,' ',name," of grid point ",p));
+      ss.ignore();
+      tree->Fill();
+      if (variation=="nominal" && name=="FWHM")
+        cout << "  nominal FWHM = " << val << endl;
+    }
+  }
+
+  fout.Write(0,TObject::kOverwrite);
+  return 0;
+}
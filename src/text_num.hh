@@ -0,0 +1,36 @@
+#ifndef text_num_hh
+#define text_num_hh
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+
+// Doubles in text messages and tables.
+// operator>> fails on nan and inf and zeroes the value,
+// so they are written as nan, inf and -inf and read with strtod:
+//   out << put_num(x);  in >> get_num(x);
+
+struct num_out { double x; };
+struct num_in  { double& x; };
+
+inline num_out put_num(double x) noexcept { return { x }; }
+inline num_in  get_num(double& x) noexcept { return { x }; }
+
+inline std::ostream& operator<<(std::ostream& out, num_out n) {
+  if (std::isnan(n.x)) return out << "nan";
+  if (std::isinf(n.x)) return out << (n.x < 0 ? "-inf" : "inf");
+  return out << n.x;
+}
+
+inline std::istream& operator>>(std::istream& in, num_in n) {
+  std::string s;
+  if (!(in >> s)) return in;
+  char *end;
+  n.x = std::strtod(s.c_str(),&end);
+  if (end==s.c_str() || *end) in.setstate(std::ios::failbit);
+  return in;
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include "toys.hh"
+
+#include <iostream>
+#include <memory>
+#include <cmath>
+#include <stdexcept>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TH1.h>
+#include <TRandom3.h>
+
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooFitResult.h>
+#include <RooMsgService.h>
+
+#include "catstr.hh"
+
+namespace {
+
+constexpr const char* toy_leaves =
+  "toy/L:status/I:covQual/I:nsig_true/D:nsig/D:nsig_err/D:nsig_pull/D"
+  ":enres/D:enres_err/D";
+
+constexpr const char* snapshot = "toy_engine_init";
+
+inline ULong64_t splitmix64(ULong64_t x) noexcept {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+inline const RooRealVar* par(const RooFitResult& res, const char* name) {
+  return static_cast<const RooRealVar*>(res.floatParsFinal().find(name));
+}
+
+}
+
+toy_engine::toy_engine(
+  workspace& ws, const TH1* sig, const TH1* bkg, ULong64_t seed
+): ws(ws), sig(sig), bkg(bkg),
+   name(cat("toys_",sig->GetName())),
+   nsig_true(sig->Integral()), seed(seed)
+{ }
+
+UInt_t toy_engine::toy_seed(Long64_t toy) const noexcept {
+  ULong64_t x = seed;
+  for (char c : name) x = splitmix64(x ^ c);
+  const UInt_t s = splitmix64(x ^ splitmix64(toy));
+  return s ? s : 1; // TRandom3 seeds 0 from the clock
+}
+
+TH1* toy_engine::generate(Long64_t toy) const {
+  TRandom3 rng(toy_seed(toy));
+  TH1 *h = static_cast<TH1*>(sig->Clone(cat(name,'_',toy).c_str()));
+  h->SetDirectory(0);
+  h->Reset();
+  for (Int_t i=1, n=h->GetNbinsX(); i<=n; ++i) {
+    const Int_t k = rng.Poisson(sig->GetBinContent(i)+bkg->GetBinContent(i));
+    h->SetBinContent(i,k);
+    h->SetBinError(i,std::sqrt(k));
+  }
+  return h;
+}
+
+toy_result toy_engine::fit(Long64_t toy) const {
+  std::unique_ptr<TH1> h(generate(toy));
+
+  fit_options opt;
+  opt.curve = false;
+  opt.verbose = false;
+  opt.ncpu = 1;
+
+  ws->loadSnapshot(snapshot);
+  const FitResult res = ws.fit(h.get(),opt).first;
+
+  toy_result r;
+  r.toy = toy;
+  r.status = res->status();
+  r.covQual = res->covQual();
+  r.nsig_true = nsig_true;
+  r.nsig = r.nsig_err = r.enres = r.enres_err = NAN;
+  if (const auto *nsig = par(*res,"NSig_bin0")) {
+    r.nsig = nsig->getVal();
+    r.nsig_err = nsig->getError();
+  }
+  if (const auto *enres = par(*res,"Uncert_EnRes_EnRes")) {
+    r.enres = enres->getVal();
+    r.enres_err = enres->getError();
+  }
+  r.nsig_pull = (r.nsig - nsig_true) / r.nsig_err;
+  return r;
+}
+
+Long64_t toy_engine::run(
+  const std::string& fname, Long64_t ntoys, unsigned nworkers
+) {
+  toy_result r;
+  Long64_t first = 0;
+
+  TFile file(fname.c_str(),"update");
+  if (file.IsZombie()) throw std::runtime_error("Cannot open "+fname);
+
+  TTree *tree = static_cast<TTree*>(file.Get(name.c_str()));
+  if (tree) {
+    tree->SetBranchAddress("toy",&r);
+    if (const Long64_t n = tree->GetEntries()) {
+      tree->GetEntry(n-1);
+      first = r.toy + 1;
+    }
+  } else {
+    tree = new TTree(name.c_str(),
+      cat("Toys of ",sig->GetName()," + exp2 background").c_str());
+    tree->Branch("toy",&r,toy_leaves);
+  }
+
+  std::cout << "\033[32mGenerating toys " << first << " to "
+            << first+ntoys-1 << " of " << sig->GetName()
+            << "\033[0m" << std::endl;
+
+  // every fit starts from the current parameter values
+  ws->saveSnapshot(snapshot,ws->allVars());
+
+  auto& msg = RooMsgService::instance();
+  const auto kill_below = msg.globalKillBelow();
+  msg.setGlobalKillBelow(RooFit::ERROR);
+
+  const auto results = fork_map(ntoys, nworkers,
+    [this,first](size_t i){ return to_bytes(fit(first+i)); });
+
+  msg.setGlobalKillBelow(kill_below);
+  ws->loadSnapshot(snapshot);
+
+  double sum = 0., sum2 = 0.;
+  Long64_t ngood = 0;
+  for (const auto& bytes : results) {
+    r = from_bytes<toy_result>(bytes);
+    tree->Fill();
+    if (r.status==0 && std::isfinite(r.nsig_pull)) {
+      sum  += r.nsig_pull;
+      sum2 += r.nsig_pull*r.nsig_pull;
+      ++ngood;
+    }
+  }
+  tree->Write(0,TObject::kOverwrite);
+
+  if (ngood) {
+    const double mean = sum/ngood;
+    std::cout << sig->GetName() << " NSig pull: mean = " << mean
+              << ", stdev = " << std::sqrt(sum2/ngood - mean*mean)
+              << " (" << ngood << " of " << ntoys << " converged)"
+              << std::endl;
+  }
+
+  return first;
+}
@@ -0,0 +1,46 @@
+#ifndef toys_hh
+#define toys_hh
+
+#include <string>
+
+#include <Rtypes.h>
+
+#include "workspace.hh"
+#include "fork_pool.hh"
+
+class TH1;
+
+// One entry of the toys tree
+// The layout matches the leaf list in toys.cc
+struct toy_result {
+  Long64_t toy;
+  Int_t    status, covQual;
+  Double_t nsig_true, nsig, nsig_err, nsig_pull, enres, enres_err;
+};
+
+// Poisson pseudo-experiments from a signal + background model,
+// fitted with the datafit workspace.
+// Toy i is generated from a seed derived from (seed, name, i) only,
+// and every fit starts from the same parameter snapshot,
+// so results don't depend on the number of workers.
+class toy_engine {
+  workspace& ws;
+  const TH1 *sig, *bkg;
+  std::string name;
+  Double_t nsig_true;
+  ULong64_t seed;
+
+public:
+  toy_engine(workspace& ws, const TH1* sig, const TH1* bkg, ULong64_t seed);
+
+  UInt_t toy_seed(Long64_t toy) const noexcept;
+  TH1* generate(Long64_t toy) const;
+  toy_result fit(Long64_t toy) const;
+
+  // Append ntoys toys to tree toys_<sig name> in file fname,
+  // continuing after the last toy already stored there.
+  // Returns the index of the first generated toy.
+  Long64_t run(const std::string& fname, Long64_t ntoys, unsigned nworkers);
+};
+
+#endif
@@ -6,9 +6,10 @@
 #include <ostream>
 #include <iomanip>
 #include <utility>
+#include <cmath>
 
 // number of precision digits
-int err_prec(double err, int n=2) noexcept {
+inline int err_prec(double err, int n=2) noexcept {
   const double log_err = std::log10(err);
   if (log_err < -8) return 0;
   else if (log_err < 0) return n - log_err;
@@ -0,0 +1,79 @@
+#include "variations.hh"
+
+#include <cstring>
+
+#include <TTree.h>
+#include <TBranch.h>
+#include <TLeaf.h>
+#include <TH1.h>
+
+#include "regex.hh"
+#include "seqmap.hh"
+
+using namespace std;
+
+vector<variation> find_variations(TTree* tree, const string& syst_re) {
+  static const regex branch_re("HGamEventInfo_(.+)__1(down|up)AuxDyn\\.m_yy");
+  const regex syst_match(syst_re);
+
+  // branches by systematic, in tree order
+  seqmap<pair<string,string>> systs;
+  systs["EG_SCALE_ALL"];
+  systs["EG_RESOLUTION_ALL"];
+
+  smatch m;
+  for (auto *b : *tree->GetListOfBranches()) {
+    const string name = b->GetName();
+    if (!regex_match(name,m,branch_re)) continue;
+    const string syst = m.str(1);
+    if (!regex_match(syst,syst_match)) continue;
+    auto& branches = systs[syst];
+    (m.str(2)=="down" ? branches.first : branches.second) = name;
+  }
+
+  vector<variation> vars {{ "nominal", "nominal", "HGamEventInfoAuxDyn.m_yy" }};
+  for (const auto& syst : systs) {
+    string group = syst.first;
+    if (group=="EG_SCALE_ALL") group = "scale";
+    else if (group=="EG_RESOLUTION_ALL") group = "res";
+    if (!syst.second.first.empty())
+      vars.push_back({ group+"_down", group, syst.second.first });
+    if (!syst.second.second.empty())
+      vars.push_back({ group+"_up", group, syst.second.second });
+  }
+  return vars;
+}
+
+string variation_group(const string& name) {
+  for (const char* suffix : {"_down","_up"}) {
+    const size_t n = strlen(suffix);
+    if (name.size() > n && !name.compare(name.size()-n,n,suffix))
+      return name.substr(0,name.size()-n);
+  }
+  return name;
+}
+
+vector<vector<TH1*>> group_variations(const vector<TH1*>& hs) {
+  vector<vector<TH1*>> groups;
+  string prev;
+  for (TH1 *h : hs) {
+    const string group = variation_group(h->GetName());
+    if (groups.empty() || group!=prev) groups.emplace_back();
+    groups.back().push_back(h);
+    prev = group;
+  }
+  return groups;
+}
+
+vector<result> read_stats_tree(TTree* tree) {
+  vector<result> results;
+  tree->GetEntry(0);
+  for (auto *b : *tree->GetListOfBranches()) {
+    for (auto *l : *static_cast<TBranch*>(b)->GetListOfLeaves()) {
+      auto *leaf = static_cast<TLeaf*>(l);
+      results.push_back({ leaf->GetName(), b->GetName(), "",
+        leaf->GetValue(0), leaf->GetValue(1) });
+    }
+  }
+  return results;
+}
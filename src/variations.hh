@@ -0,0 +1,38 @@
+#ifndef variations_hh
+#define variations_hh
+
+#include <string>
+#include <vector>
+
+#include "results.hh"
+
+class TTree;
+class TH1;
+
+// A systematic variation of the diphoton mass.
+// Variations of one systematic share the group name,
+// so they are drawn and summarized together.
+struct variation {
+  std::string name;   // e.g. nominal, scale_down, PH_EFF_ID_Uncertainty_up
+  std::string group;  // e.g. nominal, scale, PH_EFF_ID_Uncertainty
+  std::string branch; // m_yy branch in the MxAOD
+};
+
+// Nominal m_yy followed by every HGamEventInfo_<SYST>__1{down,up}AuxDyn.m_yy
+// branch of the tree with SYST matching syst_re.
+// Down comes before up. EG_SCALE_ALL and EG_RESOLUTION_ALL come first,
+// as scale and res, the remaining systematics keep tree order.
+std::vector<variation> find_variations(TTree* tree, const std::string& syst_re);
+
+// Group name of a variation histogram, its name without _down or _up
+std::string variation_group(const std::string& name);
+
+// Consecutive histograms of one group, as written by pesfit
+std::vector<std::vector<TH1*>> group_variations(const std::vector<TH1*>& hs);
+
+// Read pesfit's stats tree. There is a branch per quantity
+// with a val,err leaf pair per variation, so any number of variations
+// is read by leaf name.
+std::vector<result> read_stats_tree(TTree* tree);
+
+#endif
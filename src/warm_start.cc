@@ -0,0 +1,100 @@
+#include "warm_start.hh"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+
+#include "catstr.hh"
+
+using namespace std;
+
+// One line per entry:
+// key calls cold_calls npars name val err ...
+warm_start_store::warm_start_store(const string& fname): fname(fname) {
+  ifstream f(fname);
+  string line;
+  for (unsigned n=1; getline(f,line); ++n) {
+    if (line.empty()) continue;
+    istringstream ss(line);
+    string key;
+    entry e;
+    size_t npars = 0;
+    ss >> key >> e.calls >> e.cold_calls >> npars;
+    e.pars.resize(npars);
+    for (auto& p : e.pars) ss >> p.first >> p.second.val >> p.second.err;
+    if (!ss) throw runtime_error(cat(
+      "Bad warm start entry on line ",n," of ",fname));
+    entries[key] = move(e);
+  }
+}
+
+string warm_start_store::key(
+  const string& ws_fname, const string& category, const string& hist
+) {
+  return cat(ws_fname.substr(ws_fname.rfind('/')+1),'/',category,'/',hist);
+}
+
+unsigned warm_start_store::apply(workspace& ws, const string& key) const {
+  const auto it = entries.find(key);
+  if (it==entries.end()) return 0;
+  unsigned n = 0;
+  for (const auto& p : it->second.pars) {
+    RooRealVar *var = ws->var(p.first.c_str());
+    if (!var || var->isConstant() || !ws.depends_on(p.first.c_str()))
+      continue;
+    const double val = p.second.val;
+    if (!(var->getMin() < val && val < var->getMax())) continue;
+    var->setVal(val);
+    if (p.second.err > 0.) var->setError(p.second.err);
+    ++n;
+  }
+  return n;
+}
+
+void warm_start_store::update(const string& key, entry e, bool warm) {
+  ++nfits;
+  auto& old = entries[key];
+  if (warm) {
+    e.cold_calls = old.cold_calls;
+    ++nwarm;
+    if (e.calls && e.cold_calls) {
+      warm_calls += e.calls;
+      warm_cold_calls += e.cold_calls;
+    }
+  } else e.cold_calls = e.calls;
+  old = move(e);
+}
+
+void warm_start_store::write() const {
+  const string tmp = cat(fname,'.',getpid());
+  {
+    ofstream f(tmp);
+    f.precision(17);
+    for (const auto& e : entries) {
+      f << e.first << ' ' << e.second.calls << ' ' << e.second.cold_calls
+        << ' ' << e.second.pars.size();
+      for (const auto& p : e.second.pars)
+        f << ' ' << p.first << ' ' << p.second.val << ' ' << p.second.err;
+      f << '\n';
+    }
+    if (!f) throw runtime_error("Cannot write warm start file "+tmp);
+  }
+  if (std::rename(tmp.c_str(),fname.c_str())) {
+    std::remove(tmp.c_str());
+    throw runtime_error("Cannot replace warm start file "+fname);
+  }
+}
+
+void warm_start_store::print_savings(ostream& os) const {
+  os << "Warm start: " << nwarm << " of " << nfits << " fits";
+  if (warm_cold_calls) os << ", " << warm_calls << " likelihood calls, "
+    << warm_cold_calls << " when started cold ("
+    << 100.*(double(warm_calls)/warm_cold_calls - 1.) << "%)";
+  os << endl;
+}
@@ -0,0 +1,57 @@
+#ifndef warm_start_hh
+#define warm_start_hh
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <ostream>
+
+#include "val_err.hh"
+#include "workspace.hh"
+
+// Converged fit parameters kept in a text file between runs,
+// so that a fit with the same key starts from where it ended last time,
+// e.g. when the inputs move from one production round to the next.
+// Keys are made of the workspace file, the category and the fitted
+// histogram, see key().
+class warm_start_store {
+public:
+  struct entry {
+    std::vector<std::pair<std::string,val_err<double>>> pars;
+    // likelihood evaluations of the last fit and of the last fit
+    // that was not warm started, 0 if unknown, e.g. fitted remotely
+    unsigned long long calls = 0, cold_calls = 0;
+  };
+
+private:
+  std::string fname;
+  std::map<std::string,entry> entries;
+  unsigned nfits = 0, nwarm = 0;
+  unsigned long long warm_calls = 0, warm_cold_calls = 0;
+
+public:
+  // Entries are read from fname, if it exists
+  explicit warm_start_store(const std::string& fname);
+
+  static std::string key(const std::string& ws_fname,
+    const std::string& category, const std::string& hist);
+
+  // Set values and errors of the workspace variables from the entry.
+  // If the workspace changed since, parameters that it doesn't have,
+  // that are now constant or out of their range are left as they are.
+  // Returns the number of parameters set, 0 if there is no entry.
+  unsigned apply(workspace& ws, const std::string& key) const;
+
+  // Record a converged fit, warm if it was started by apply()
+  void update(const std::string& key, entry e, bool warm);
+
+  // Replace the file with the current entries
+  void write() const;
+
+  // Warm started fits and their likelihood evaluations,
+  // compared to the same fits when they were not warm started
+  void print_savings(std::ostream& os) const;
+};
+
+#endif
@@ -7,11 +7,11 @@
 #include <TFile.h>
 #include <TTree.h>
 #include <TH1.h>
-#include <TF1.h>
 #include <TGraph.h>
 #include <TStyle.h>
 #include <TCanvas.h>
 #include <TLatex.h>
+#include <TLine.h>
 
 #include <RooWorkspace.h>
 #include <RooRealVar.h>
@@ -24,6 +24,13 @@
 #include "root_safe_get.hh"
 #include "val_err.hh"
 #include "workspace.hh"
+#include "toys.hh"
+#include "results.hh"
+#include "variations.hh"
+#include "pages.hh"
+#include "fit_plan.hh"
+#include "bg_template.hh"
+#include "profile_scan.hh"
 
 using namespace std;
 namespace po = boost::program_options;
@@ -34,15 +41,15 @@ namespace po = boost::program_options;
 structmap(val_err<double>,hist_t,
   (nominal)(scale_down)(scale_up)(res_down)(res_up));
 
-Double_t exp2(const Double_t* x, const Double_t* p) noexcept {
-  const Double_t m = (*x-100.)/100.;
-  return exp(p[0]*m - p[1]*m*m);
-}
-
 int main(int argc, char** argv)
 {
-  string ifname, ofname, wfname, cfname;
+  string ifname, ofname, wfname, cfname, tfname, rfname, report_fname;
   bool logy, bg, dopull;
+  Long64_t ntoys;
+  ULong64_t seed;
+  unsigned njobs;
+  profile_options scan_opt;
+  scan_opt.npoints = 0;
 
   // options ---------------------------------------------------
   try {
@@ -56,6 +63,9 @@ int main(int argc, char** argv)
        "ROOT file with RooWorkspace for CB fits")
       ("config,c", po::value(&cfname),
        "configuration file name")
+      ("results,r", po::value(&rfname),
+       "read stats from pesfit .ndjson or .pesr results file\n"
+       "instead of the stats tree")
 
       ("logy,l", po::bool_switch(&logy),
        "logarithmic Y axis")
@@ -63,6 +73,21 @@ int main(int argc, char** argv)
        "add exp2 background to signal")
       ("pull,p", po::bool_switch(&dopull),
        "calculate fit pulls")
+
+      ("toys,t", po::value(&ntoys)->default_value(0),
+       "number of pseudo-experiments per variation, requires --bg")
+      ("toys-file", po::value(&tfname)->default_value("toys.root"),
+       "ROOT file to which toys are appended")
+      ("seed", po::value(&seed)->default_value(1),
+       "toys random seed")
+      ("scan,s", po::value(&scan_opt.npoints),
+       "profile likelihood points around the fixed offsets, 0 for no scan")
+      ("scan-sigma", po::value(&scan_opt.nsigma)->default_value(3.),
+       "half width of the profile scan in errors of the unconstrained fit")
+      ("jobs,j", po::value(&njobs)->default_value(4),
+       "number of worker processes for fits, toy fits and pdf pages")
+      ("report", po::value(&report_fname),
+       "write JSON report of stage timing and counters at exit")
     ;
 
     po::positional_options_description pos;
@@ -82,27 +107,29 @@ int main(int argc, char** argv)
         vm["config"].as<string>().c_str(), desc), vm);
     }
     po::notify(vm);
+
+    if (ntoys && !bg) throw runtime_error("--toys requires --bg");
+    // the datafit pdf doesn't depend on the fixed offsets
+    if (scan_opt.npoints && bg)
+      throw runtime_error("--scan cannot be used with --bg");
   } catch (std::exception& e) {
     cerr << "\033[31mArgs: " <<  e.what() <<"\033[0m"<< endl;
     return 1;
   }
   // end options ---------------------------------------------------
 
+  if (!report_fname.empty()) run_report::write_at_exit(report_fname,argv[0]);
+
   TFile *fin = new TFile(ifname.c_str(),"read");
   if (fin->IsZombie()) return 1;
 
   seqmap<hist_t> stats;
-  {
-    TTree *tree = get<TTree>(fin,"stats");
-    auto *branches = tree->GetListOfBranches();
-    stats.reserve(branches->GetEntries());
-    for (auto x : *branches) {
-      cout << "Branch: " << x->GetName() << endl;
-      tree->SetBranchAddress(x->GetName(),&stats[x->GetName()]);
-    }
-    tree->GetEntry(0);
+  if (!rfname.empty()) {
+    fill_stats(stats, read_results(rfname,
+      {"mean_offset_bin0","sigma_offset_bin0","hist_window_mean","FWHM"}));
+  } else {
+    fill_stats(stats, read_stats_tree(get<TTree>(fin,"stats")));
   }
-  cout << endl;
 
   TH1
     *h_nominal    = get<TH1>(fin,"nominal"),
@@ -121,16 +148,8 @@ int main(int argc, char** argv)
   workspace ws(wfname,bg);
 
   if (bg) { // add background
-    Double_t params[2] = { -3.4472e+00, 4.6032e-01 };
-    TF1 fexp2("exp2",exp2,105,140,2);
-    fexp2.SetParameters(params);
-
-    TH1 *h_bg = new TH1D("hexp2",";m_{#gamma#gamma} [GeV];N Events",
-      h_nominal->GetNbinsX(),
-      h_nominal->GetXaxis()->GetXmin(),
-      h_nominal->GetXaxis()->GetXmax());
-    h_bg->Eval(&fexp2);
-    h_bg->Scale(24740./h_bg->Integral());
+    const TH1 *h_bg = exp2_template(
+      -3.4472e+00, 4.6032e-01, *h_nominal->GetXaxis(), 24740.);
 
     auto& nsig_mc = stats["nsig_mc"];
     const double scale_to_nsig_nom
@@ -146,280 +165,228 @@ int main(int argc, char** argv)
     nsig_mc.res_down   = h_res_down  ->Integral();
     nsig_mc.res_up     = h_res_up    ->Integral();
 
+    if (ntoys) { // generate and fit toys before the signal is modified
+      timed_stage stage("toys");
+      for (const TH1* h : {h_scale_down,h_scale_up,h_res_down,h_res_up})
+        toy_engine(ws,h,h_bg,seed).run(tfname,ntoys,njobs);
+    }
+
     h_scale_down->Add(h_bg);
     h_scale_up  ->Add(h_bg);
     h_res_down  ->Add(h_bg);
     h_res_up    ->Add(h_bg);
   }
 
-  TCanvas canv;
-  canv.SetMargin(0.1,0.04,0.1,0.1);
-  if (logy) canv.SetLogy();
-  canv.SaveAs((ofname+'[').c_str());
-
-  TLatex lbl;
-  lbl.SetTextFont(43);
-  lbl.SetTextSize(20);
-  lbl.SetNDC();
-
-  auto draw_stat = [&lbl](const TH1* hist, double y, double x){
-    auto lblp = lbl.DrawLatex(0.14,y,hist->GetName());
-    lblp->SetTextColor(hist->GetLineColor());
-    lblp->DrawLatex(0.31,y,cat(x).c_str());
+  // Every row of a page is a fit of a histogram with some parameters
+  // fixed, or, without background, an unconstrained fit taken from
+  // the input. The fits are declared first and run as one fit plan,
+  // each from the workspace as loaded.
+  struct fit_row {
+    TH1 *hist;
+    TGraph *curve;
+    Double_t val; // parameter shown without background
+    Double_t nsig, pull, rel_diff; // with background
+  };
+  struct row_plan {
+    TH1 *hist;
+    const char *par;
+    TGraph *input_curve; // null if fitted here
+    size_t job;
   };
 
-  // SCALE ************************************************
-
-  h_scale_down->SetTitle("Unconstrained fit");
-  h_scale_down->Draw();
-  h_scale_up->Draw("same");
-
-  if (bg) {
-    lbl.DrawLatex(0.62,0.85,"NSig_fit");
-    lbl.DrawLatex(0.73,0.85,"pull");
-    lbl.DrawLatex(0.84,0.85,"rel_diff");
-
-    const auto& nsig_mc_stat = stats["nsig_mc"];
-
-    auto fit = ws.fit(h_scale_down);
-    fit.second->Draw("same");
-    Double_t nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    Double_t rel_diff = (nsig - nsig_mc_stat.scale_down) / nsig_mc_stat.scale_down;
-    Double_t pull = NAN;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
+  vector<fit_job> jobs;
+  auto fitted = [&](TH1* hist, const char* par,
+                    vector<pair<string,double>> fixed) -> row_plan {
+    vector<string> extract { par };
+    if (bg) {
+      extract.push_back("NSig_bin0");
+      if (dopull) extract.push_back("Uncert_EnRes_EnRes");
     }
+    jobs.push_back({hist,move(fixed),move(extract)});
+    return { hist, par, nullptr, jobs.size()-1 };
+  };
+  // Unconstrained fits are taken from the input without background
+  auto input = [&](TH1* hist, TGraph* curve, const char* par) -> row_plan {
+    if (bg) return fitted(hist,par,{});
+    return { hist, par, curve, 0 };
+  };
 
-    auto lblp = lbl.DrawLatex(0.45,0.80,"scale_down");
-    lblp->SetTextColor(h_scale_down->GetLineColor());
-    lblp->DrawLatex(0.62,0.80,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.80,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.80,Form("%.5f",rel_diff));
-
-    fit = ws.fit(h_scale_up);
-    fit.second->Draw("same");
-    nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    rel_diff = (nsig - nsig_mc_stat.scale_up) / nsig_mc_stat.scale_up;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
-    }
+  const auto window_mean = stats["hist_window_mean"];
+  const auto fwhm = stats["FWHM"];
+  const vector<pair<const char*,vector<row_plan>>> page_plans {
+    // SCALE ************************************************
+    { "Unconstrained fit", {
+      input(h_scale_down,f_scale_down,"mean_offset_bin0"),
+      input(h_scale_up  ,f_scale_up  ,"mean_offset_bin0")
+    }},
+    { bg ? "Should be exactly the same as previous"
+         : "Mean offset set to window mean - 125", {
+      fitted(h_scale_down,"mean_offset_bin0",
+        {{"mean_offset_bin0", window_mean.scale_down - 125.}}),
+      fitted(h_scale_up  ,"mean_offset_bin0",
+        {{"mean_offset_bin0", window_mean.scale_up - 125.}})
+    }},
+    // RESOLUTION *******************************************
+    { "Unconstrained fit", {
+      input(h_res_down,f_res_down,"sigma_offset_bin0"),
+      input(h_res_up  ,f_res_up  ,"sigma_offset_bin0")
+    }},
+    { bg ? "Should be exactly the same as previous"
+         : "Sigma offset set to HWHM", {
+      fitted(h_res_down,"sigma_offset_bin0",
+        {{"sigma_offset_bin0", fwhm.res_down/2.}}),
+      fitted(h_res_up  ,"sigma_offset_bin0",
+        {{"sigma_offset_bin0", fwhm.res_up/2.}})
+    }}
+  };
 
-    lblp = lbl.DrawLatex(0.45,0.75,"scale_up");
-    lblp->SetTextColor(h_scale_up->GetLineColor());
-    lblp->DrawLatex(0.62,0.75,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.75,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.75,Form("%.5f",rel_diff));
-  } else {
-    f_scale_down->Draw("same");
-    f_scale_up->Draw("same");
-    draw_stat(h_scale_down,0.84,stats["mean_offset_bin0"].scale_down);
-    draw_stat(h_scale_up  ,0.80,stats["mean_offset_bin0"].scale_up  );
+  vector<fit_job_result> fits;
+  {
+    timed_stage stage("fit");
+    fits = run_fit_plan(ws,jobs,njobs);
   }
 
-  canv.SaveAs(ofname.c_str());
-
-  if (bg) h_scale_down->SetTitle("Should be exactly the same as previous");
-  else h_scale_down->SetTitle("Mean offset set to window mean - 125");
-  ws.fixVal("mean_offset_bin0", stats["hist_window_mean"].scale_down - 125.);
-  auto fit = ws.fit(h_scale_down);
-
-  test(fit.first->GetName())
-  auto& pars = fit.first->floatParsFinal();
-  for (int i=0, n=pars.getSize(); i<n; ++i)
-    test(pars[i].GetName())
-
-  h_scale_down->Draw();
-  fit.second->Draw("same");
-
-  if (bg) {
-    lbl.DrawLatex(0.62,0.85,"NSig_fit");
-    lbl.DrawLatex(0.73,0.85,"pull");
-    lbl.DrawLatex(0.84,0.85,"rel_diff");
-
-    const auto& nsig_mc_stat = stats["nsig_mc"];
-
-    Double_t nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    Double_t rel_diff = (nsig - nsig_mc_stat.scale_down) / nsig_mc_stat.scale_down;
-    Double_t pull = NAN;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
-    }
-
-    auto lblp = lbl.DrawLatex(0.45,0.80,"scale_down");
-    lblp->SetTextColor(h_scale_down->GetLineColor());
-    lblp->DrawLatex(0.62,0.80,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.80,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.80,Form("%.5f",rel_diff));
-  } else draw_stat(h_scale_down,0.84,
-    static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("mean_offset_bin0")
-    )->getVal());
-
-  ws.fixVal("mean_offset_bin0", stats["hist_window_mean"].scale_up - 125.);
-  fit = ws.fit(h_scale_up);
-  h_scale_up->Draw("same");
-  fit.second->Draw("same");
-  if (bg) {
-    const auto& nsig_mc_stat = stats["nsig_mc"];
-
-    Double_t nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    Double_t rel_diff = (nsig - nsig_mc_stat.scale_up) / nsig_mc_stat.scale_up;
-    Double_t pull = NAN;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
-    }
-
-    auto lblp = lbl.DrawLatex(0.45,0.75,"scale_up");
-    lblp->SetTextColor(h_scale_up->GetLineColor());
-    lblp->DrawLatex(0.62,0.75,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.75,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.75,Form("%.5f",rel_diff));
-  } else draw_stat(h_scale_up,0.80,
-    static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("mean_offset_bin0")
-    )->getVal());
-
-  canv.SaveAs(ofname.c_str());
-
-  // RESOLUTION *******************************************
-
-  h_res_down->SetTitle("Unconstrained fit");
-  h_res_down->Draw();
-  h_res_up->Draw("same");
-
-  if (bg) {
-    lbl.DrawLatex(0.62,0.85,"NSig_fit");
-    lbl.DrawLatex(0.73,0.85,"pull");
-    lbl.DrawLatex(0.84,0.85,"rel_diff");
-
-    const auto& nsig_mc_stat = stats["nsig_mc"];
-
-    auto fit = ws.fit(h_res_down);
-    fit.second->Draw("same");
-    Double_t nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    Double_t rel_diff = (nsig - nsig_mc_stat.res_down) / nsig_mc_stat.res_down;
-    Double_t pull = NAN;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
-    }
+  auto row_of = [&](const row_plan& p) -> fit_row {
+    if (p.input_curve) return fit_row {
+      p.hist, p.input_curve, stats[p.par][p.hist->GetName()], NAN, NAN, NAN };
+    const auto& fit = fits[p.job];
+    fit_row row { p.hist, fit.curve, NAN, NAN, NAN, NAN };
+    if (bg) {
+      const Double_t nsig_mc = stats["nsig_mc"][p.hist->GetName()];
+      row.nsig = fit.pars[1].val;
+      row.rel_diff = (row.nsig - nsig_mc) / nsig_mc;
+      if (dopull) row.pull = fit.pars[2].val;
+    } else row.val = fit.pars[0].val;
+    return row;
+  };
 
-    auto lblp = lbl.DrawLatex(0.45,0.80,"res_down");
-    lblp->SetTextColor(h_res_down->GetLineColor());
-    lblp->DrawLatex(0.62,0.80,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.80,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.80,Form("%.5f",rel_diff));
-
-    fit = ws.fit(h_res_up);
-    fit.second->Draw("same");
-    nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    rel_diff = (nsig - nsig_mc_stat.res_up) / nsig_mc_stat.res_up;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
-    }
+  auto page = [&](const char* title, const vector<fit_row>& rows) -> page_t {
+    return [&,title,rows](TCanvas& canv){
+      canv.SetMargin(0.1,0.04,0.1,0.1);
+      canv.SetLogy(logy);
+
+      TLatex lbl;
+      lbl.SetTextFont(43);
+      lbl.SetTextSize(20);
+      lbl.SetNDC();
+
+      rows.front().hist->SetTitle(title);
+      if (bg) {
+        lbl.DrawLatex(0.62,0.85,"NSig_fit");
+        lbl.DrawLatex(0.73,0.85,"pull");
+        lbl.DrawLatex(0.84,0.85,"rel_diff");
+      }
+
+      int i=0;
+      for (const auto& row : rows) {
+        row.hist->Draw(i ? "same" : "");
+        row.curve->Draw("same");
+        if (bg) {
+          const double y = 0.80-0.05*i;
+          auto lblp = lbl.DrawLatex(0.45,y,row.hist->GetName());
+          lblp->SetTextColor(row.hist->GetLineColor());
+          lblp->DrawLatex(0.62,y,Form("%.2f",row.nsig));
+          lblp->DrawLatex(0.73,y,Form("%.3f",row.pull));
+          lblp->DrawLatex(0.84,y,Form("%.5f",row.rel_diff));
+        } else {
+          const double y = 0.84-0.04*i;
+          auto lblp = lbl.DrawLatex(0.14,y,row.hist->GetName());
+          lblp->SetTextColor(row.hist->GetLineColor());
+          lblp->DrawLatex(0.31,y,cat(row.val).c_str());
+        }
+        ++i;
+      }
+    };
+  };
 
-    lblp = lbl.DrawLatex(0.45,0.75,"res_up");
-    lblp->SetTextColor(h_res_up->GetLineColor());
-    lblp->DrawLatex(0.62,0.75,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.75,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.75,Form("%.5f",rel_diff));
-  } else {
-    f_res_down->Draw("same");
-    f_res_up->Draw("same");
-    draw_stat(h_res_down,0.84,stats["sigma_offset_bin0"].res_down);
-    draw_stat(h_res_up  ,0.80,stats["sigma_offset_bin0"].res_up  );
+  vector<page_t> pages;
+  for (const auto& p : page_plans) {
+    vector<fit_row> rows;
+    for (const auto& r : p.second) rows.push_back(row_of(r));
+    pages.push_back(page(p.first,rows));
   }
 
-  canv.SaveAs(ofname.c_str());
-
-  if (bg) h_res_down->SetTitle("Should be exactly the same as previous");
-  else h_res_down->SetTitle("Sigma offset set to HWHM");
-  ws.fixVal("sigma_offset_bin0", stats["FWHM"].res_down/2.);
-  fit = ws.fit(h_res_down);
-  h_res_down->Draw();
-  fit.second->Draw("same");
-  if (bg) {
-    lbl.DrawLatex(0.62,0.85,"NSig_fit");
-    lbl.DrawLatex(0.73,0.85,"pull");
-    lbl.DrawLatex(0.84,0.85,"rel_diff");
-
-    const auto& nsig_mc_stat = stats["nsig_mc"];
-
-    Double_t nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    Double_t rel_diff = (nsig - nsig_mc_stat.res_down) / nsig_mc_stat.res_down;
-    Double_t pull = NAN;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
-    }
-
-    auto lblp = lbl.DrawLatex(0.45,0.80,"res_down");
-    lblp->SetTextColor(h_res_down->GetLineColor());
-    lblp->DrawLatex(0.62,0.80,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.80,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.80,Form("%.5f",rel_diff));
-  } else draw_stat(h_res_down,0.84,
-    static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("sigma_offset_bin0")
-    )->getVal());
-
-  ws.fixVal("sigma_offset_bin0", stats["FWHM"].res_up/2.);
-  fit = ws.fit(h_res_up);
-  h_res_up->Draw("same");
-  fit.second->Draw("same");
-  if (bg) {
-    const auto& nsig_mc_stat = stats["nsig_mc"];
-
-    Double_t nsig = static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("NSig_bin0")
-    )->getVal();
-    Double_t rel_diff = (nsig - nsig_mc_stat.res_up) / nsig_mc_stat.res_up;
-    Double_t pull = NAN;
-    if (dopull) {
-      pull = static_cast<RooRealVar*>(
-        fit.first->floatParsFinal().find("Uncert_EnRes_EnRes")
-      )->getVal();
-    }
-
-    auto lblp = lbl.DrawLatex(0.45,0.75,"res_up");
-    lblp->SetTextColor(h_res_up->GetLineColor());
-    lblp->DrawLatex(0.62,0.75,Form("%.2f",nsig));
-    lblp->DrawLatex(0.73,0.75,Form("%.3f",pull));
-    lblp->DrawLatex(0.84,0.75,Form("%.5f",rel_diff));
-  } else draw_stat(h_res_up,0.80,
-    static_cast<RooRealVar*>(
-      fit.first->floatParsFinal().find("sigma_offset_bin0")
-    )->getVal());
-
-  canv.SaveAs(ofname.c_str());
+  // Profile likelihood of the fixed offsets ************************
+  // Each variation is scanned around its unconstrained fit,
+  // widened to contain the value the offset is fixed to
+  if (scan_opt.npoints) {
+    timed_stage stage("profile");
+    struct scan_row { TH1 *hist; double fixed; profile_scan scan; };
+    auto scan = [&](TH1* hist, const char* par, double fixed) -> scan_row {
+      auto sopt = scan_opt;
+      sopt.include = { fixed };
+      scan_row row { hist, fixed, run_profile_scan(ws,hist,par,sopt,njobs) };
+      const auto x = row.scan.crossings();
+      cout << par << ' ' << hist->GetName()
+           << ": best " << row.scan.best.val
+           << ", 1 sigma [" << x.first << ',' << x.second << ']'
+           << ", fixed " << fixed << endl;
+      return row;
+    };
+    const vector<pair<const char*,vector<scan_row>>> scan_pages {
+      { "mean_offset_bin0", {
+        scan(h_scale_down,"mean_offset_bin0",window_mean.scale_down - 125.),
+        scan(h_scale_up  ,"mean_offset_bin0",window_mean.scale_up - 125.)
+      }},
+      { "sigma_offset_bin0", {
+        scan(h_res_down,"sigma_offset_bin0",fwhm.res_down/2.),
+        scan(h_res_up  ,"sigma_offset_bin0",fwhm.res_up/2.)
+      }}
+    };
+
+    for (const auto& p : scan_pages) pages.push_back(
+      [p](TCanvas& canv){
+        canv.SetMargin(0.1,0.04,0.1,0.1);
+
+        TLatex lbl;
+        lbl.SetTextFont(43);
+        lbl.SetTextSize(20);
+        lbl.SetNDC();
+
+        double xmin = INFINITY, xmax = -INFINITY, ymax = 0.;
+        for (const auto& row : p.second)
+          for (const auto& pt : row.scan.points) {
+            if (pt.x < xmin) xmin = pt.x;
+            if (pt.x > xmax) xmax = pt.x;
+            if (pt.dnll > ymax) ymax = pt.dnll;
+          }
+
+        int i=0;
+        for (const auto& row : p.second) {
+          TGraph *g = row.scan.graph();
+          const Color_t color = row.hist->GetLineColor();
+          g->SetTitle(cat("Profile likelihood;",p.first,";#DeltaNLL").c_str());
+          g->SetLineColor(color);
+          g->SetMarkerColor(color);
+          g->SetMarkerStyle(20);
+          g->SetMarkerSize(0.6);
+          if (!i) {
+            g->SetMinimum(0.);
+            g->SetMaximum(1.1*ymax);
+            g->GetXaxis()->SetLimits(xmin,xmax);
+          }
+          g->Draw(i ? "LP" : "ALP");
+
+          TLine line;
+          line.SetLineColor(color);
+          line.SetLineStyle(2);
+          line.DrawLine(row.fixed,0.,row.fixed,1.1*ymax);
+
+          const auto x = row.scan.crossings();
+          const double y = 0.84-0.04*i;
+          auto lblp = lbl.DrawLatex(0.14,y,row.hist->GetName());
+          lblp->SetTextColor(color);
+          lblp->DrawLatex(0.31,y,Form("%.4g [%.4g, %.4g], fixed %.4g",
+            row.scan.best.val,x.first,x.second,row.fixed));
+          ++i;
+        }
+        TLine half; // 1 sigma
+        half.SetLineStyle(3);
+        half.DrawLine(xmin,0.5,xmax,0.5);
+      });
+  }
 
-  canv.SaveAs((ofname+']').c_str());
+  save_pages(ofname,pages,njobs);
 
   return 0;
 }
@@ -2,19 +2,25 @@
 
 template<typename T> inline T sq(T x) noexcept { return x*x; }
 
+// Densities in variable width bins are weighted by the bin width
 Double_t window_mean(const TH1* hist, Double_t a, Double_t b) noexcept {
+  const bool variable = hist->GetXaxis()->IsVariableBinSize();
+  auto content = [=](int i){
+    return variable ? hist->GetBinContent(i)*hist->GetBinWidth(i)
+                    : hist->GetBinContent(i);
+  };
   Int_t ai = hist->FindFixBin(a);
   Int_t bi = hist->FindFixBin(b);
   Double_t mean = 0., stdev = 0., sumw = 0.;
   for (int i=ai; i<=bi; ++i) {
-    const Double_t w = hist->GetBinContent(i);
+    const Double_t w = content(i);
     const Double_t x = hist->GetBinCenter(i);
     sumw += w;
     mean += x*w;
   }
   mean /= sumw;
   for (int i=ai; i<=bi; ++i) {
-    const Double_t w = hist->GetBinContent(i);
+    const Double_t w = content(i);
     const Double_t x = hist->GetBinCenter(i);
     stdev += sq(x-mean)*w;
   }
@@ -24,7 +30,7 @@ Double_t window_mean(const TH1* hist, Double_t a, Double_t b) noexcept {
   bi = hist->FindFixBin(mean+2.0*stdev);
   mean = 0.; sumw = 0.;
   for (int i=ai; i<=bi; ++i) {
-    const Double_t w = hist->GetBinContent(i);
+    const Double_t w = content(i);
     sumw += w;
     mean += hist->GetBinCenter(i) * w;
   }
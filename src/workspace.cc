@@ -1,50 +1,348 @@
 #include "workspace.hh"
 
+#include <iostream>
 #include <map>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <TMatrixDSym.h>
 
 #include <TFile.h>
+#include <TDirectory.h>
+#include <TError.h>
 
+#include <RooGlobalFunc.h>
 #include <RooWorkspace.h>
 #include <RooRealVar.h>
 #include <RooSimultaneous.h>
 #include <RooCategory.h>
 #include <RooDataHist.h>
+#include <RooDataSet.h>
 #include <RooFitResult.h>
 #include <RooPlot.h>
 #include <RooCurve.h>
+#include <RooMinimizer.h>
+#include <RooNLLVar.h>
+#include <RooSimWSTool.h>
 
 #include "root_safe_get.hh"
+#include "catstr.hh"
+
+namespace {
+
+std::string abs_path(const std::string& fname) {
+  char *path = realpath(fname.c_str(),nullptr);
+  const std::string abs = path ? path : fname;
+  free(path);
+  return abs;
+}
+
+// Path, size and modification time of the file a cache was made from
+std::string file_stamp(const std::string& fname) {
+  struct stat st;
+  if (::stat(fname.c_str(),&st)) return { };
+  return cat(abs_path(fname),' ',st.st_size,' ',st.st_mtime);
+}
+
+// Cache of a workspace of fname, in $PESFIT_CACHE_DIR, or else
+// $XDG_CACHE_HOME/pesfit or ~/.cache/pesfit, named by the absolute
+// path of fname. The directory is created if needed.
+// Empty if there is no cache directory.
+std::string cache_fname(const std::string& fname, const char* ws_name) {
+  std::string dir;
+  if (const char *env = getenv("PESFIT_CACHE_DIR")) dir = env;
+  else if (const char *env = getenv("XDG_CACHE_HOME")) dir = cat(env,"/pesfit");
+  else if (const char *env = getenv("HOME")) dir = cat(env,"/.cache/pesfit");
+  if (dir.empty()) return { };
+  for (size_t i = dir.find('/',1); ; i = dir.find('/',i+1)) {
+    ::mkdir(dir.substr(0,i).c_str(),0755); // fails if it exists
+    if (i==std::string::npos) break;
+  }
+
+  std::string name = abs_path(fname);
+  std::replace(name.begin(),name.end(),'/','%');
+  return cat(dir,'/',name,'.',ws_name,".cache.root");
+}
+
+}
+
+workspace::workspace(const std::string& fname, bool bg, bool use_cache)
+: fname(fname), bg(bg), file(nullptr), ws(nullptr), owns_ws(false)
+{
+  const char *ws_name  = bg ? "datafit" : "mcfit";
+  const char *pdf_name = bg ? "sig_bkg_sim_pdf" : "mc_sim_pdf_bin0";
+  const std::string cfname = use_cache ? cache_fname(fname,ws_name) : "";
+  const std::string stamp = file_stamp(fname);
+
+  // The cache is used only if it was made from the file as it is now
+  if (!cfname.empty() && !::access(cfname.c_str(),R_OK)) {
+    file = new TFile(cfname.c_str(),"read");
+    auto *source = dynamic_cast<TNamed*>(file->Get("source"));
+    if (!file->IsZombie() && source && source->GetTitle()==stamp)
+      ws = dynamic_cast<RooWorkspace*>(file->Get(ws_name));
+    if (!ws) {
+      delete file;
+      file = nullptr;
+    }
+  }
+
+  if (!ws) {
+    file = new TFile(fname.c_str(),"read");
+    ws = get<RooWorkspace>(file,ws_name);
+    if (use_cache) {
+      // Work on the same pruned workspace as the one cached,
+      // so that a run has the same variables whether or not
+      // it read the cache
+      auto *pruned = new RooWorkspace(ws->GetName(),ws->GetTitle());
+      if (pruned->import(*ws->pdf(pdf_name),RooFit::Silence())) delete pruned;
+      else {
+        ws = pruned;
+        owns_ws = true;
+        if (!cfname.empty()) write_cache(cfname,stamp);
+      }
+    }
+  }
+
+  sim_pdf = static_cast<RooSimultaneous*>(ws->obj(pdf_name));
+  rcat = static_cast<RooCategory*>(ws->obj(bg ? "sample" : "mc_sample"));
+  myy = static_cast<RooRealVar*>(ws->var("m_yy"));
+}
+
+// Save the pruned workspace, with only the fitted pdf and the variables
+// it depends on, with their values, ranges and constant flags.
+// The file is renamed into place, so concurrent runs never read
+// a partial cache. Failure to write is not an error.
+void workspace::write_cache(const std::string& cfname,
+  const std::string& stamp) const
+{
+  TDirectory::TContext context; // restore the current directory
+  const std::string tmp = cat(cfname,'.',getpid());
+  {
+    const int level = gErrorIgnoreLevel;
+    gErrorIgnoreLevel = kFatal; // the directory may be read-only
+    TFile out(tmp.c_str(),"recreate");
+    gErrorIgnoreLevel = level;
+    if (out.IsZombie()) return;
+    ws->Write();
+    TNamed("source",stamp.c_str()).Write();
+  }
+  if (std::rename(tmp.c_str(),cfname.c_str())) std::remove(tmp.c_str());
+}
 
-workspace::workspace(const std::string& fname, bool bg)
-: bg(bg),
-  file(new TFile(fname.c_str(),"read")),
-  ws(get<RooWorkspace>(file,bg ? "datafit" : "mcfit")),
-  sim_pdf(static_cast<RooSimultaneous*>(
-    ws->obj(bg ? "sig_bkg_sim_pdf" : "mc_sim_pdf_bin0"))),
-  rcat(static_cast<RooCategory*>(ws->obj(bg ? "sample" : "mc_sample"))),
-  myy(static_cast<RooRealVar*>(ws->var("m_yy")))
-{ }
+workspace::workspace(const workspace& other)
+: fname(other.fname), bg(other.bg), file(nullptr),
+  ws(new RooWorkspace(*other.ws)), owns_ws(true)
+{
+  sim_pdf = static_cast<RooSimultaneous*>(ws->obj(other.sim_pdf->GetName()));
+  rcat = static_cast<RooCategory*>(ws->obj(other.rcat->GetName()));
+  myy = static_cast<RooRealVar*>(ws->var("m_yy"));
+  for (const auto& p : other.bins_pdfs)
+    bins_pdfs[p.first] = static_cast<RooSimultaneous*>(
+      ws->pdf(p.second->GetName()));
+}
+
+std::unique_ptr<workspace> workspace::clone() const {
+  return std::unique_ptr<workspace>(new workspace(*this));
+}
 
 workspace::~workspace() {
-  delete myy;
-  delete rcat;
-  delete sim_pdf;
+  if (owns_ws) delete ws; // pruned or cloned, with all its objects
+  else {
+    delete myy;
+    delete rcat;
+    delete sim_pdf;
+  }
   delete file;
 }
 
+auto workspace::save() const -> snapshot {
+  snapshot s;
+  for (auto *arg : ws->allVars())
+    if (auto *v = dynamic_cast<RooRealVar*>(arg))
+      s.push_back({v, v->getMin(), v->getMax(),
+                   v->getVal(), v->getError(), v->isConstant()});
+  return s;
+}
+
+void workspace::restore(const snapshot& s) {
+  for (const auto& v : s) {
+    v.var->setRange(v.min,v.max);
+    v.var->setVal(v.val);
+    v.var->setError(v.err);
+    v.var->setConstant(v.constant);
+  }
+}
+
+namespace {
+RooRealVar* find_var(RooWorkspace* ws, const char* name) {
+  RooRealVar *var = ws->var(name);
+  if (!var) throw std::runtime_error(cat(
+    "No variable ",name," in workspace ",ws->GetName(),
+    ", or the fitted pdf doesn't depend on it"));
+  return var;
+}
+}
+
 void workspace::setRange(const char* name, Double_t min, Double_t max) {
-  ws->var(name)->setRange(min,max);
+  find_var(ws,name)->setRange(min,max);
 }
 
 void workspace::fixVal(const char* name, Double_t val) {
-  auto *var = ws->var(name);
+  auto *var = find_var(ws,name);
   var->setRange(val,val);
   var->setVal(val);
 }
 
-auto workspace::fit(TH1* hist) const -> std::pair<FitResult,TGraph*> {
+bool workspace::depends_on(const char* name) const {
+  const auto *var = ws->var(name);
+  return var && sim_pdf->dependsOn(*var);
+}
+
+bool converged(const RooFitResult& res) {
+  return res.status()==0 && res.covQual()==3 && res.edm() < 1e-3;
+}
+
+namespace {
+
+// RooDataHist takes bin contents as counts. Densities in variable
+// width bins are converted to counts. Uniform bins are imported as
+// they are: for the shape they differ from counts only by a common
+// factor, and the --bg workflows (window_hwhm, toys) treat uniform
+// bin contents as the yields to fit. Extended yields are therefore
+// bin contents for uniform bins, but counts for variable width bins.
+std::unique_ptr<TH1> counts_hist(const TH1* hist) {
+  if (!hist->GetXaxis()->IsVariableBinSize()) return nullptr;
+  std::unique_ptr<TH1> counts(static_cast<TH1*>(
+    hist->Clone(cat(hist->GetName(),"_counts").c_str())));
+  counts->SetDirectory(0);
+  for (int i=1, n=counts->GetNbinsX(); i<=n; ++i) {
+    const double w = counts->GetBinWidth(i);
+    counts->SetBinContent(i,hist->GetBinContent(i)*w);
+    counts->SetBinError(i,hist->GetBinError(i)*w);
+  }
+  return counts;
+}
+
+// Steps of the fit, from the cheapest. A fit escalates to the next
+// step only if the previous one didn't converge.
+struct fit_step {
+  const char *name;
+  int strategy;
+  bool initial_hesse, reseed;
+};
+const fit_step fit_steps[] = {
+  { "strategy0", 0, false, false },
+  { "strategy1", 1, false, false },
+  { "strategy2", 2, true,  false },
+  { "reseed",    2, true,  true  } // from the initial values
+};
+
+// The steps of RooAbsPdf::fitTo() with Extended(extended),
+// SumW2Error, Minuit2 and Offset, done here with a RooMinimizer,
+// which counts likelihood evaluations for the run report.
+// Migrad and Hesse are run with the fit_steps in order until the fit
+// converges, the last one being Strategy(2) with InitialHesse from the
+// initial values. Every step is timed as a stage, and the path taken
+// is in the result's status history.
+RooFitResult* minimize(RooAbsPdf& pdf, RooAbsData& data, bool extended,
+                       const RooCmdArg& num_cpu, bool verbose) {
+  timed_stage stage("minimize");
+  std::unique_ptr<RooAbsReal> nll(pdf.createNLL(data,
+    RooFit::Extended(extended),
+    num_cpu,
+    RooFit::Offset(true)
+  ));
+
+  std::vector<std::pair<RooRealVar*,std::pair<double,double>>> seeds;
+  {
+    std::unique_ptr<RooArgSet> pars(nll->getParameters(RooArgSet()));
+    for (auto *arg : *pars)
+      if (auto *v = dynamic_cast<RooRealVar*>(arg))
+        if (!v->isConstant())
+          seeds.push_back({v,{v->getVal(),v->getError()}});
+  }
+
+  RooMinimizer m(*nll);
+  m.setMinimizerType("Minuit2");
+  m.setPrintLevel(verbose ? 1 : -1);
+  m.optimizeConst(2);
+  for (const auto& step : fit_steps) {
+    timed_stage stage(step.name);
+    if (step.reseed)
+      for (const auto& s : seeds) {
+        s.first->setVal(s.second.first);
+        s.first->setError(s.second.second);
+      }
+    m.setStrategy(step.strategy);
+    if (step.initial_hesse) m.hesse();
+    int status = m.minimize("Minuit2","Migrad");
+    if (!status) status = m.hesse();
+    const std::unique_ptr<RooFitResult> res(m.save());
+    if (verbose) std::cout << "Fit step " << step.name
+      << ": status " << status << ", covQual " << res->covQual()
+      << ", edm " << res->edm() << std::endl;
+    if (status==0 && converged(*res)) break;
+  }
+
+  // SumW2Error: correct the covariance matrix V of the weighted
+  // likelihood to V C^-1 V, with C from the sum of weights squared
+  std::unique_ptr<RooFitResult> rw(m.save());
+  auto weight_squared = [&nll](bool flag){
+    std::unique_ptr<RooArgSet> comps(nll->getComponents());
+    for (auto *comp : *comps)
+      if (auto *var = dynamic_cast<RooNLLVar*>(comp))
+        var->applyWeightSquared(flag);
+  };
+  weight_squared(true);
+  m.hesse();
+  std::unique_ptr<RooFitResult> rw2(m.save());
+  weight_squared(false);
+
+  TMatrixDSym matC = rw2->covarianceMatrix();
+  matC.Invert();
+  matC.Similarity(rw->covarianceMatrix());
+  m.applyCovarianceMatrix(matC);
+
+  run_report::count_fits(1,m.evalCounter());
+  return m.save();
+}
+
+}
+
+auto workspace::fit(TH1* hist, const fit_options& opt) const
+-> std::pair<FitResult,TGraph*> {
+  if (const char *server = getenv("PESFIT_FIT_SERVER")) {
+    try {
+      return remote(server,hist,opt);
+    } catch (const fit_server_unavailable& e) {
+      static bool warned = false; // once per process
+      if (!warned) std::cerr << "\033[33m" << e.what()
+        << ", fitting locally\033[0m" << std::endl;
+      warned = true;
+    }
+  }
+
+  const auto crdh = binned(hist);
+
+  // Now we are ready to fit! We have a PDF and a RooDataHist
+  RooFitResult *res = minimize(*sim_pdf,*crdh,bg,
+    RooFit::NumCPU(opt.ncpu),opt.verbose);
+  if (opt.verbose) res->Print("v");
+
+  if (!opt.curve) return {FitResult(res),nullptr};
+  return {FitResult(res),curve(*crdh)};
+}
+
+std::unique_ptr<RooDataHist> workspace::binned(TH1* hist) const {
   // Produce a RooDataHist object from the TH1
-  RooDataHist rdh("dh","dh",RooArgSet(*myy),hist);
+  const auto counts = counts_hist(hist);
+  RooDataHist rdh("dh","dh",RooArgSet(*myy),counts ? counts.get() : hist);
 
   // This map might look a bit useless,
   // but the PDF is designed to fit several datasets simultaneously.
@@ -56,23 +354,65 @@ auto workspace::fit(TH1* hist) const -> std::pair<FitResult,TGraph*> {
 
   // With the map we can build one combined dataset
   // that has the proper link of the category information.
-  RooDataHist crdh("c_dh","c_dh",
-    RooArgSet(*myy), RooFit::Index(*rcat), RooFit::Import(rdhmap));
+  return std::unique_ptr<RooDataHist>(new RooDataHist("c_dh","c_dh",
+    RooArgSet(*myy), RooFit::Index(*rcat), RooFit::Import(rdhmap)));
+}
 
-  // Now we are ready to fit! We have a PDF and a RooDataHist
-  RooFitResult *res = sim_pdf->fitTo(crdh,
-    RooFit::Extended(bg),
-    RooFit::InitialHesse(true),
-    RooFit::SumW2Error(true),
-    RooFit::Save(true),
-    RooFit::NumCPU(4),
-    RooFit::Minimizer("Minuit2"),
-    RooFit::Offset(true),
-    RooFit::Strategy(2)
-  );
+double workspace::nll(TH1* hist) const {
+  const auto crdh = binned(hist);
+  std::unique_ptr<RooAbsReal> nll(sim_pdf->createNLL(*crdh,
+    RooFit::Extended(bg)));
 
+  // sum w / sum w^2 of the imported bins
+  const auto counts = counts_hist(hist);
+  const TH1 *h = counts ? counts.get() : hist;
+  double sumw = 0., sumw2 = 0.;
+  for (int i=1, n=h->GetNbinsX(); i<=n; ++i) {
+    const double x = h->GetBinCenter(i);
+    if (x < myy->getMin() || myy->getMax() < x) continue;
+    sumw  += h->GetBinContent(i);
+    sumw2 += h->GetBinError(i)*h->GetBinError(i);
+  }
+  return sumw2 > 0. ? nll->getVal()*sumw/sumw2 : nll->getVal();
+}
+
+auto workspace::fit(
+  const std::vector<float>& m_yy, const std::vector<float>& weight,
+  const fit_options& opt
+) const -> std::pair<FitResult,TGraph*> {
+  RooRealVar w("w","w",1.);
+  RooDataSet ds("ds","ds",RooArgSet(*myy,w),RooFit::WeightVar(w));
+  {
+    timed_stage stage("dataset");
+    const double min = myy->getMin(), max = myy->getMax();
+    for (size_t e=0, n=weight.size(); e<n; ++e) {
+      const double m = m_yy[e];
+      if (std::isnan(m) || m < min || max < m) continue;
+      myy->setVal(m);
+      ds.add(RooArgSet(*myy),weight[e]);
+    }
+  }
+
+  // Same category structure as the binned fit
+  std::map<std::string,RooDataSet*> dsmap {
+    {bg ? "data_bin0" : "mc_125", &ds}
+  };
+  RooDataSet cds("c_ds","c_ds",RooArgSet(*myy,w),
+    RooFit::Index(*rcat), RooFit::Import(dsmap), RooFit::WeightVar(w));
+
+  // Bulk partition: each process sums the likelihood of a block of events
+  RooFitResult *res = minimize(*sim_pdf,cds,bg,
+    RooFit::NumCPU(opt.ncpu,0),opt.verbose);
+  if (opt.verbose) res->Print("v");
+
+  if (!opt.curve) return {FitResult(res),nullptr};
+  return {FitResult(res),curve(cds)};
+}
+
+TGraph* workspace::curve(RooAbsData& data) const {
+  timed_stage stage("curve");
   RooPlot *frame = myy->frame();
-  crdh.plotOn(frame,
+  data.plotOn(frame,
     RooFit::LineColor(12),
     RooFit::Cut(bg ? "sample == sample::data_bin0"
                    : "mc_sample == mc_sample::mc_125")
@@ -80,13 +420,110 @@ auto workspace::fit(TH1* hist) const -> std::pair<FitResult,TGraph*> {
   sim_pdf->plotOn(frame,
     RooFit::LineColor(85),
     RooFit::Slice(*rcat, bg ? "data_bin0" : "mc_125"),
-    RooFit::ProjWData(RooArgSet(*rcat), crdh),
+    RooFit::ProjWData(RooArgSet(*rcat), data),
     RooFit::Precision(1e-5)
   );
-  auto *curve = frame->getCurve();
-  // frame->Draw("same");
-  // curve->Draw("same");
-  res->Print("v");
+  return frame->getCurve();
+}
+
+auto workspace::fit_bins(const std::vector<TH1*>& hists,
+  const std::vector<std::string>& split, const fit_options& opt)
+-> std::pair<FitResult,std::vector<TGraph*>> {
+  if (split.empty()) throw std::runtime_error(
+    "workspace::fit_bins: no parameters to split");
+  std::string split_list;
+  for (const auto& par : split)
+    split_list += (split_list.empty() ? "" : ",") + par;
+
+  // One category state vbin<i> per histogram.
+  // The model is built once for every number of bins and split.
+  const std::string cat_name = cat("vbins",hists.size());
+  auto *vbins = ws->cat(cat_name.c_str());
+  if (!vbins) {
+    std::string states;
+    for (size_t i=0; i<hists.size(); ++i)
+      states += cat(i ? "," : "","vbin",i);
+    vbins = static_cast<RooCategory*>(
+      ws->factory(cat(cat_name,'[',states,']').c_str()));
+  }
+
+  RooSimultaneous*& bins_pdf = bins_pdfs[cat(cat_name,':',split_list)];
+  if (!bins_pdf) {
+    // Split parameters get a copy per state, named <par>_vbin<i>,
+    // the rest are shared
+    RooSimWSTool sct(*ws);
+    bins_pdf = sct.build(
+      cat("sim_",cat_name,'_',bins_pdfs.size()).c_str(),
+      sim_pdf->getPdf(bg ? "data_bin0" : "mc_125")->GetName(),
+      RooFit::SplitParam(split_list.c_str(),cat_name.c_str()));
+    if (!bins_pdf) throw std::runtime_error(
+      "workspace::fit_bins: cannot split "+split_list);
+  }
+
+  std::vector<std::unique_ptr<RooDataHist>> rdhs;
+  std::map<std::string,RooDataHist*> rdhmap;
+  for (size_t i=0; i<hists.size(); ++i) {
+    const auto counts = counts_hist(hists[i]);
+    rdhs.emplace_back(new RooDataHist(cat("dh",i).c_str(),"",
+      RooArgSet(*myy),counts ? counts.get() : hists[i]));
+    rdhmap[cat("vbin",i)] = rdhs.back().get();
+  }
+  RooDataHist crdh("c_dh","c_dh",
+    RooArgSet(*myy), RooFit::Index(*vbins), RooFit::Import(rdhmap));
+
+  // One likelihood, with the categories evaluated in parallel processes
+  RooFitResult *res = minimize(*bins_pdf,crdh,bg,
+    RooFit::NumCPU(opt.ncpu,2),opt.verbose);
+  if (opt.verbose) res->Print("v");
+
+  std::vector<TGraph*> curves;
+  if (opt.curve) {
+    timed_stage stage("curve");
+    for (size_t i=0; i<hists.size(); ++i) {
+      const std::string state = cat("vbin",i);
+      RooPlot *frame = myy->frame();
+      crdh.plotOn(frame,
+        RooFit::LineColor(12),
+        RooFit::Cut(cat(cat_name,"==",cat_name,"::",state).c_str())
+      );
+      bins_pdf->plotOn(frame,
+        RooFit::LineColor(85),
+        RooFit::Slice(*vbins,state.c_str()),
+        RooFit::ProjWData(RooArgSet(*vbins),crdh),
+        RooFit::Precision(1e-5)
+      );
+      curves.push_back(frame->getCurve());
+    }
+  }
+
+  return {FitResult(res),curves};
+}
+
+// Send the histogram and the state of all workspace variables
+// to a fit server, and update the variables with the fit result,
+// as if the fit was done here
+auto workspace::remote(const char* server, TH1* hist,
+                       const fit_options& opt) const
+-> std::pair<FitResult,TGraph*> {
+  fit_request req;
+  req.workspace = abs_path(fname);
+  req.bg = bg;
+  req.curve = opt.curve;
+  req.set_hist(hist);
+  for (auto *arg : ws->allVars())
+    if (auto *v = dynamic_cast<RooRealVar*>(arg))
+      req.vars.push_back({ v->GetName(), v->getVal(), v->getError(),
+                           v->getMin(), v->getMax(), v->isConstant() });
 
-  return {FitResult(res),curve};
+  auto fit = remote_fit(server,req);
+  run_report::count_fits(1,0);
+  for (auto *arg : fit.first->floatParsFinal()) {
+    const auto *par = static_cast<const RooRealVar*>(arg);
+    if (auto *v = ws->var(par->GetName())) {
+      v->setVal(par->getVal());
+      v->setError(par->getError());
+    }
+  }
+  if (opt.verbose) fit.first->Print("v");
+  return fit;
 }
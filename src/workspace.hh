@@ -2,6 +2,8 @@
 #define pesfit_workspace_hh
 
 #include <string>
+#include <vector>
+#include <map>
 #include <utility>
 #include <memory>
 
@@ -9,6 +11,9 @@
 
 #include <RooFitResult.h>
 
+#include "run_report.hh"
+#include "fit_socket.hh"
+
 class TFile;
 class TGraph;
 
@@ -16,19 +21,67 @@ class RooWorkspace;
 class RooSimultaneous;
 class RooCategory;
 class RooRealVar;
+class RooAbsData;
+class RooDataHist;
 
 using FitResult = std::unique_ptr<RooFitResult>;
 
+// Parameters of the mcfit signal pdf recorded from CB fits
+constexpr const char* cb_pars[] = {
+  "crys_alpha_bin0", "crys_norm_bin0", "fcb_bin0", "gaus_kappa_bin0",
+  "gaus_mean_offset_bin0", "mean_offset_bin0", "sigma_offset_bin0"
+};
+constexpr size_t ncb_pars = sizeof(cb_pars)/sizeof(*cb_pars);
+
+// Migrad and Hesse succeeded, the covariance matrix is accurate
+// and the estimated distance to the minimum is small.
+// workspace::fit goes through its fit steps until this holds.
+bool converged(const RooFitResult& res);
+
+struct fit_options {
+  bool curve   = true; // plot the fitted pdf and return its curve
+  bool verbose = true; // print the fit result
+  int  ncpu    = 4;    // RooFit::NumCPU, must be 1 inside forked workers
+};
+
+// Value, error, range and constant flag of a workspace variable
+struct var_state {
+  RooRealVar *var;
+  double min, max, val, err;
+  bool constant;
+};
+
 class workspace {
+  std::string fname;
   bool bg;
   TFile *file;
   RooWorkspace *ws;
+  bool owns_ws;
   RooSimultaneous *sim_pdf;
   RooCategory *rcat;
   RooRealVar *myy;
+  std::map<std::string,RooSimultaneous*> bins_pdfs; // built by fit_bins
+
+  std::pair<FitResult,TGraph*> remote(const char* server, TH1* hist,
+    const fit_options& opt) const;
+
+  TGraph* curve(RooAbsData& data) const; // of the single category fit
+
+  // Single category dataset of a histogram
+  std::unique_ptr<RooDataHist> binned(TH1* hist) const;
+
+  void write_cache(const std::string& cfname, const std::string& stamp) const;
+
+  workspace(const workspace& other); // deep copy, for clone()
 
 public:
-  workspace(const std::string& fname, bool bg=false);
+  // With use_cache, the workspace is pruned to the fitted pdf and the
+  // variables it depends on, and read from a cache file in
+  // $PESFIT_CACHE_DIR, $XDG_CACHE_HOME/pesfit or ~/.cache/pesfit
+  // if it was made from the current fname, otherwise fname is read
+  // and the cache is written. Other variables are not available
+  // either way. Without use_cache, the whole workspace is read.
+  workspace(const std::string& fname, bool bg=false, bool use_cache=true);
   ~workspace();
 
   inline RooWorkspace* operator->() noexcept { return ws; }
@@ -36,7 +89,57 @@ public:
   void setRange(const char* name, Double_t min, Double_t max);
   void fixVal(const char* name, Double_t val);
 
-  std::pair<FitResult,TGraph*> fit(TH1* hist) const;
+  // Whether the fitted pdf depends on the variable
+  bool depends_on(const char* name) const;
+
+  // State of all variables, restored without reloading the file.
+  // A snapshot only applies to the workspace it was saved from.
+  using snapshot = std::vector<var_state>;
+  snapshot save() const;
+  void restore(const snapshot& s);
+
+  // Independent copy of the model in memory, with the variables
+  // in their current state, e.g. for fits that change them
+  std::unique_ptr<workspace> clone() const;
+
+  // Negative log-likelihood of the histogram at the current values
+  // of the variables. Unlike the minimum of a fit, which is offset,
+  // it can be compared between fits of the same histogram.
+  // It is scaled by sum w / sum w^2 of the bins, to the likelihood of
+  // the effective number of events, so that differences follow the
+  // usual statistics also for weighted histograms, e.g. in fb/GeV.
+  // The scale is 1 for unweighted counts.
+  double nll(TH1* hist) const;
+
+  // Fits are sent to the fit server (fitd) listening on the socket
+  // named by the PESFIT_FIT_SERVER environment variable, if it is set,
+  // and fitted locally if no server accepts the connection.
+  // Histograms are densities, and may have variable width bins.
+  // Extended (bg) yields are in units of the bin contents, as summed
+  // by TH1::Integral(), for uniform bins, but counts, as summed by
+  // Integral("width"), for variable width bins, so they are comparable
+  // only between fits with the same kind of binning.
+  std::pair<FitResult,TGraph*> fit(TH1* hist,
+    const fit_options& opt = fit_options()) const;
+
+  // Unbinned fit of weighted events, m_yy in GeV.
+  // Events outside the m_yy range or with NaN m_yy are skipped.
+  // The likelihood is evaluated by opt.ncpu processes,
+  // each on a contiguous block of events.
+  // Extended yields are in units of the sum of weights, not per GeV.
+  // Always fitted locally.
+  std::pair<FitResult,TGraph*> fit(
+    const std::vector<float>& m_yy, const std::vector<float>& weight,
+    const fit_options& opt = fit_options()) const;
+
+  // Fit histograms together in one likelihood, one category per histogram.
+  // Parameters in split get a copy per histogram i, named <par>_vbin<i>,
+  // the others are shared. opt.ncpu processes evaluate the categories.
+  // The curves are returned in histogram order, if opt.curve.
+  // Always fitted locally.
+  std::pair<FitResult,std::vector<TGraph*>> fit_bins(
+    const std::vector<TH1*>& hists, const std::vector<std::string>& split,
+    const fit_options& opt = fit_options());
 };
 
 #endif